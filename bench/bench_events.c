@@ -0,0 +1,257 @@
+// Microbenchmarks for the event path and the memory primitives.
+// Runs headless, prints one result per line as JSON (default) or CSV:
+//
+//   ./build/bench_events [--csv] [--quick]
+
+#include "zzz.h"
+#include "zzz_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static b32 g_csv = FALSE;
+static b32 g_first = TRUE;
+static u64 g_scale = 1; // divides iteration counts with --quick
+
+// Defeats dead store elimination of the values read back
+static volatile u64 g_sink;
+
+static void _benchReport(const char* name, const char* unit, u64 items, u64 bytes, u64 elapsed)
+{
+    f64 perItem = (f64)elapsed / (f64)items;
+    f64 gbps = bytes ? (f64)bytes / (f64)elapsed : 0.0; // bytes per ns == GB/s
+    if(g_csv) {
+        if(g_first)
+            printf("name,unit,items,ns_per_item,gb_per_s\n");
+        printf("%s,%s,%llu,%.3f,%.3f\n", name, unit, (unsigned long long)items, perItem, gbps);
+    } else {
+        printf("%s{\"name\":\"%s\",\"unit\":\"%s\",\"items\":%llu,\"ns_per_item\":%.3f,\"gb_per_s\":%.3f}",
+                g_first ? "[\n  " : ",\n  ", name, unit, (unsigned long long)items, perItem, gbps);
+    }
+    g_first = FALSE;
+}
+
+static void _benchInit(ZZZ* app, u32 capacity, u32 maxCapacity, i32 overflow)
+{
+    ZZZInitInfo info;
+    zMemZero(&info, sizeof(info));
+    info.eventQueueCapacity = capacity;
+    info.eventQueueMaxCapacity = maxCapacity;
+    info.eventQueueOverflow = overflow;
+    if(_zInitEventQueue(&app->eq, &info) != ZERR_NONE) {
+        // Every benchmark relies on the queue, fail the run instead of crashing
+        fprintf(stderr, "failed to init the event queue\n");
+        exit(1);
+    }
+}
+
+static void _benchDrain(ZZZ* app)
+{
+    static ZEvent events[1024];
+    _zFlushEvents(&app->eq);
+    while(zNextEvents(app, events, 1024))
+        ;
+}
+
+// Claims and publishes batches of 256 events, draining in between so the
+// queue never grows
+static void _benchNewEvent(void)
+{
+    static ZZZ app;
+    _benchInit(&app, 256, 256, ZEVENT_OVERFLOW_DROP_NEWEST);
+    u64 batches = 40000 / g_scale;
+    u64 elapsed = 0;
+    for(u64 b = 0; b < batches; ++b) {
+        u64 start = zGetTime();
+        for(u32 i = 0; i < 256; ++i) {
+            ZEvent* ev = _zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH);
+            ev->window.x = (i32)i;
+        }
+        elapsed += zGetTime() - start;
+        _benchDrain(&app);
+    }
+    _benchReport("new_event", "event", batches * 256, 0, elapsed);
+    _zTerminateEventQueue(&app.eq);
+}
+
+static void _benchInputKey(void)
+{
+    static ZZZ app;
+    _benchInit(&app, 256, 256, ZEVENT_OVERFLOW_DROP_NEWEST);
+    u64 batches = 40000 / g_scale;
+    u64 elapsed = 0;
+    for(u64 b = 0; b < batches; ++b) {
+        u64 start = zGetTime();
+        for(u32 i = 0; i < 256; i += 2) {
+            _zInputKey(&app.eq, ZKEY_A + (i & 15), 0, ZEVENT_KEY_PRESSED, 0);
+            _zInputKey(&app.eq, ZKEY_A + (i & 15), 0, ZEVENT_KEY_RELEASED, 0);
+        }
+        elapsed += zGetTime() - start;
+        _benchDrain(&app);
+    }
+    _benchReport("input_key", "event", batches * 256, 0, elapsed);
+    _zTerminateEventQueue(&app.eq);
+}
+
+static void _benchNextEvent(void)
+{
+    static ZZZ app;
+    _benchInit(&app, 256, 256, ZEVENT_OVERFLOW_DROP_NEWEST);
+    u64 batches = 40000 / g_scale;
+    u64 elapsed = 0;
+    ZEvent ev;
+    for(u64 b = 0; b < batches; ++b) {
+        for(u32 i = 0; i < 256; ++i)
+            _zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH)->window.x = (i32)i;
+        _zFlushEvents(&app.eq);
+        u64 start = zGetTime();
+        while(zNextEvent(&app, &ev))
+            g_sink += (u64)ev.window.x;
+        elapsed += zGetTime() - start;
+    }
+    _benchReport("next_event", "event", batches * 256, 0, elapsed);
+    _zTerminateEventQueue(&app.eq);
+}
+
+// Producer and consumer walk a 16 slot lane in lockstep, so every few
+// events the indices wrap around the end of the storage
+static void _benchWraparound(void)
+{
+    static ZZZ app;
+    _benchInit(&app, 16, 16, ZEVENT_OVERFLOW_DROP_NEWEST);
+    u64 count = 10000000 / g_scale;
+    ZEvent ev;
+    u64 start = zGetTime();
+    for(u64 i = 0; i < count; ++i) {
+        _zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH)->window.x = (i32)i;
+        if((i & 7) == 7) {
+            _zFlushEvents(&app.eq);
+            while(zNextEvent(&app, &ev))
+                g_sink += (u64)ev.window.x;
+        }
+    }
+    _benchReport("wraparound", "event", count, 0, zGetTime() - start);
+    _zTerminateEventQueue(&app.eq);
+}
+
+// Cost of an event arriving at a full lane for each overflow policy
+static void _benchOverflow(const char* name, i32 overflow)
+{
+    static ZZZ app;
+    _benchInit(&app, 64, 64, overflow);
+    while(_zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH) && app.eq.dropped == 0 && app.eq.coalesced == 0)
+        ;
+    u64 count = 10000000 / g_scale;
+    u64 start = zGetTime();
+    for(u64 i = 0; i < count; ++i) {
+        ZEvent* ev = _zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH);
+        if(ev)
+            ev->window.x = (i32)i;
+    }
+    _benchReport(name, "event", count, 0, zGetTime() - start);
+    _zTerminateEventQueue(&app.eq);
+}
+
+// Fills a lane from 64 slots up to 16384, growing it 8 times
+static void _benchGrow(void)
+{
+    static ZZZ app;
+    u64 rounds = 200 / g_scale + 1;
+    u64 elapsed = 0;
+    for(u64 r = 0; r < rounds; ++r) {
+        _benchInit(&app, 64, 16384, ZEVENT_OVERFLOW_GROW);
+        u64 start = zGetTime();
+        for(u32 i = 0; i < 16384; ++i)
+            _zNewEvent(&app.eq, ZEVENT_WINDOW_REFRESH)->window.x = (i32)i;
+        elapsed += zGetTime() - start;
+        _zTerminateEventQueue(&app.eq);
+    }
+    _benchReport("overflow_grow", "event", rounds * 16384, 0, elapsed);
+}
+
+static void _benchMemory(u8* dst, u8* src, u64 size)
+{
+    char name[64];
+    // Aim for roughly the same number of bytes per size
+    u64 iterations = (1ull << 28) / size / g_scale + 1;
+
+    u64 start = zGetTime();
+    for(u64 i = 0; i < iterations; ++i)
+        zMemSet(dst, (i32)i, size);
+    snprintf(name, sizeof(name), "mem_set_%llu", (unsigned long long)size);
+    _benchReport(name, "call", iterations, iterations * size, zGetTime() - start);
+    g_sink += dst[size - 1];
+
+    start = zGetTime();
+    for(u64 i = 0; i < iterations; ++i)
+        zMemZero(dst, size);
+    snprintf(name, sizeof(name), "mem_zero_%llu", (unsigned long long)size);
+    _benchReport(name, "call", iterations, iterations * size, zGetTime() - start);
+    g_sink += dst[size - 1];
+
+    start = zGetTime();
+    for(u64 i = 0; i < iterations; ++i) {
+        src[i & (size - 1)] = (u8)i;
+        zMemCopy(dst, src, size);
+    }
+    snprintf(name, sizeof(name), "mem_copy_%llu", (unsigned long long)size);
+    _benchReport(name, "call", iterations, iterations * size, zGetTime() - start);
+    g_sink += dst[size - 1];
+
+    // The same loops through libc as the baseline
+    start = zGetTime();
+    for(u64 i = 0; i < iterations; ++i)
+        memset(dst, (int)i, size);
+    snprintf(name, sizeof(name), "libc_memset_%llu", (unsigned long long)size);
+    _benchReport(name, "call", iterations, iterations * size, zGetTime() - start);
+    g_sink += dst[size - 1];
+
+    start = zGetTime();
+    for(u64 i = 0; i < iterations; ++i) {
+        src[i & (size - 1)] = (u8)i;
+        memcpy(dst, src, size);
+    }
+    snprintf(name, sizeof(name), "libc_memcpy_%llu", (unsigned long long)size);
+    _benchReport(name, "call", iterations, iterations * size, zGetTime() - start);
+    g_sink += dst[size - 1];
+}
+
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--csv") == 0) {
+            g_csv = TRUE;
+        } else if(strcmp(argv[i], "--quick") == 0) {
+            g_scale = 100;
+        } else {
+            fprintf(stderr, "usage: %s [--csv] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    _benchNewEvent();
+    _benchInputKey();
+    _benchNextEvent();
+    _benchWraparound();
+    _benchOverflow("overflow_drop_newest", ZEVENT_OVERFLOW_DROP_NEWEST);
+    _benchOverflow("overflow_drop_oldest", ZEVENT_OVERFLOW_DROP_OLDEST);
+    _benchOverflow("overflow_coalesce", ZEVENT_OVERFLOW_COALESCE);
+    _benchGrow();
+
+    u64 maxSize = 1 << 20;
+    u8* dst = zMemReserve(maxSize);
+    u8* src = zMemReserve(maxSize);
+    if(!dst || !src) {
+        fprintf(stderr, "failed to reserve memory\n");
+        return 1;
+    }
+    for(u64 size = 16; size <= maxSize; size *= 4)
+        _benchMemory(dst, src, size);
+    zMemRelease(dst);
+    zMemRelease(src);
+
+    if(!g_csv)
+        printf("\n]\n");
+    return 0;
+}
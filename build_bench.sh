@@ -0,0 +1,9 @@
+BUILD_DIR="./build"
+CC="cc"
+CFLAGS="-Wall -Wextra -ggdb -O2 -Iinclude -Isrc"
+LDFLAGS="-L$BUILD_DIR -lzzz"
+
+./build_linux.sh
+
+echo "Building Benchmark: Events"
+$CC $CFLAGS -o $BUILD_DIR/bench_events ./bench/bench_events.c $LDFLAGS
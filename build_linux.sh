@@ -0,0 +1,23 @@
+CC="cc"
+AR="ar"
+CFLAGS="-Wall -Wextra -ggdb -O2 -Iinclude"
+BUILD_DIR="./build"
+
+OBJ_DIR="$BUILD_DIR/obj"
+NAME="zzz"
+
+if [ ! -d $BUILD_DIR ]; then
+    mkdir $BUILD_DIR
+fi
+if [ ! -d $OBJ_DIR ]; then
+    mkdir $OBJ_DIR
+fi
+
+echo "Generating object files"
+$CC $CFLAGS -o $OBJ_DIR/zzz_platform_linux.o -c ./src/zzz_platform_linux.c
+$CC $CFLAGS -o $OBJ_DIR/zzz_event.o -c ./src/zzz_event.c
+$CC $CFLAGS -o $OBJ_DIR/zzz_action.o -c ./src/zzz_action.c
+$CC $CFLAGS -o $OBJ_DIR/zzz_memory.o -c ./src/zzz_memory.c
+
+echo "Linking stage: Static Library"
+$AR rcs $BUILD_DIR/"lib$NAME.a" $OBJ_DIR/zzz_event.o $OBJ_DIR/zzz_action.o $OBJ_DIR/zzz_memory.o $OBJ_DIR/zzz_platform_linux.o
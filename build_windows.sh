@@ -1,7 +1,7 @@
 CC="clang"
 AR="llvm-ar"
 CFLAGS="-Wall -Wextra -ggdb -Iinclude"
-LDFLAGS="-luser32 -lkernel32 -lgdi32"
+LDFLAGS="-luser32 -lkernel32 -lgdi32 -lshell32"
 BUILD_DIR="./build"
 
 OBJ_DIR="$BUILD_DIR/obj"
@@ -17,6 +17,8 @@ fi
 echo "Generating object files"
 $CC $CFLAGS -o $OBJ_DIR/zzz_platform_win32.o -c ./src/zzz_platform_win32.c
 $CC $CFLAGS -o $OBJ_DIR/zzz_event.o -c ./src/zzz_event.c
+$CC $CFLAGS -o $OBJ_DIR/zzz_action.o -c ./src/zzz_action.c
+$CC $CFLAGS -o $OBJ_DIR/zzz_memory.o -c ./src/zzz_memory.c
 
 echo "Linking stage: Static Library"
-$AR rcs $BUILD_DIR/"$NAME.lib" $OBJ_DIR/zzz_event.o $OBJ_DIR/zzz_platform_win32.o
+$AR rcs $BUILD_DIR/"$NAME.lib" $OBJ_DIR/zzz_event.o $OBJ_DIR/zzz_action.o $OBJ_DIR/zzz_memory.o $OBJ_DIR/zzz_platform_win32.o
@@ -8,6 +8,7 @@ int main(void)
 {
     ZZZ* zapp = zMemReserve(sizeof(ZZZ));
     ZZZInitInfo zinfo;
+    zMemZero(&zinfo, sizeof(zinfo));
     zinfo.name = "Hello, World";
     zinfo.surfaceWidth = 800;
     zinfo.surfaceHeight = 600;
@@ -63,6 +64,7 @@ int main(void)
         SwapBuffers(GetDC(zapp->surface.hWnd));
     }
 
-    zMemRelease(zapp);
     glbUninit();
+    zTerminate(zapp);
+    zMemRelease(zapp);
 }
@@ -101,6 +101,12 @@ extern "C" {
     #define ZZZ_CC_GCC 0
 #endif
 
+#if ZZZ_CC_MSVC
+    #define ZZZ_ALIGN(n) __declspec(align(n))
+#else
+    #define ZZZ_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
 #ifndef NULL
     #define NULL ((void*)0)
 #endif
@@ -114,7 +120,13 @@ extern "C" {
 /** 
  * Configurations
  */
-#define ZZZ_EVENT_QUEUE_CAPACITY 64
+#define ZZZ_EVENT_QUEUE_CAPACITY 64 // default initial capacity, rounded up to a power of two
+#define ZZZ_EVENT_QUEUE_MAX_CAPACITY 16384 // default growth limit
+#define ZZZ_CACHE_LINE_SIZE 64
+#define ZZZ_POSTED_EVENT_CAPACITY 64 // events zPostEvent can hold between two zPollEvents, power of two
+#define ZZZ_EVENT_LOG_BUFFER_CAPACITY 256 // events buffered before a recording is written out, also written at zRecordEnd
+#define ZZZ_TRANSIENT_ARENA_SIZE (16 << 20) // bytes reserved per half of the per poll event data such as dropped file paths and text, committed as used
+#define ZZZ_MEM_NORESERVE_SIZE (64ull << 20) // zMemReserve sizes from which Linux maps without reserving swap
 
 #ifdef ZZZ_RELEASE
     #define NDEBUG 1
@@ -142,21 +154,199 @@ typedef u32 b32; // bool32
  */
 typedef i32 ZErr;
 
+/**
+ * Only the payload matching `type` is valid, every payload shares the same
+ * storage so an event stays small enough to fit two in a cache line
+ */
 typedef struct {
     i32 type;
-    struct { i32 width, height; } size;
-    struct { f32 x, y; } scroll;
-    struct { i32 key, scancode, mods; } keyboard;
-    struct { i32 x, y, width, height; } window;
-    struct { i32 button, mods; } mouse;
-    struct { f32 x, y; } cursor;
-    struct { char** paths; i32 count; } file;
-    struct { f32 x, y; } scale;
+    u64 time; // capture time in monotonic nanoseconds, same clock as zGetTime
+    union {
+        struct { i32 width, height; } size;
+        struct { f32 x, y; } scroll;
+        struct { i32 key, scancode, mods; } keyboard;
+        struct { i32 x, y, width, height; } window;
+        struct { i32 button, mods; } mouse;
+        struct { f32 x, y; } cursor;
+        struct { char** paths; i32 count; } file; // paths are valid until the next zPollEvents, with a threaded queue until the consumer's next drain call
+        struct { f32 x, y; } scale;
+        struct { u32 offset, length; } text; // UTF-8 bytes in the per poll payload storage, see zGetEventText for how long they stay valid
+        struct { i32 code, value; void* data; } user;
+    };
 } ZEvent;
 
 typedef struct {
-    u64 tail, head;
-    ZEvent events[ZZZ_EVENT_QUEUE_CAPACITY];
+    u64 sequence;
+    ZEvent event;
+} ZPostedEvent;
+
+typedef void (*ZEventCallback)(const ZEvent* event, void* user);
+
+typedef struct {
+    ZEventCallback fn;
+    void* user;
+} ZEventHandler;
+
+enum {
+    ZEVENT_LANE_INPUT = 0, // keys, mouse buttons, cursor, scroll, text
+    ZEVENT_LANE_WINDOW, // window, monitor, joystick, file drop and user events
+    ZEVENT_LANE_COUNT,
+};
+
+/**
+ * Ring of events indexed by free running counters. The storage is reserved
+ * once for maxCapacity events, so growing never relocates it.
+ *
+ * The producer claims slots at `write` and publishes them by storing
+ * `head`, the consumer advances `tail`. Each side only writes its own
+ * cache line, so a threaded queue exchanges them with acquire/release
+ * atomics.
+ */
+typedef struct {
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 write;
+    u64 cachedTail; // last tail seen by the producer
+
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 head;
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 tail;
+
+    // Read by both sides, only changes when growing which a threaded queue never does
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) ZEvent* events;
+    u8* types; // optional dense copy of each slot's event type, scanned by zFindEvents
+    u64 capacity, mask; // capacity is a power of two, mask = capacity - 1
+    u64 maxCapacity;
+} ZEventLane;
+
+/**
+ * Health counters of the event queue, see zGetEventStats. Per type arrays
+ * are indexed by ZEVENT_*.
+ */
+typedef struct {
+    u64 enqueued[64]; // claimed a ring slot, events dispatched to a callback are not counted
+    u64 coalesced[64]; // merged into a pending event instead of taking a slot
+    u64 dropped[64]; // lost because the queue or the transient arena was full, by the type that was lost
+    u64 drained[64]; // handed to the app by zNextEvent, zNextEvents or zConsumeEvents
+    u64 highWaterMark; // most events pending in one lane when zPollEvents published them
+    u64 maxEventsPerPoll; // most events enqueued during a single zPollEvents
+} ZEventStats;
+
+/**
+ * Keyboard and mouse state kept by the core from the input it translates,
+ * so polling "is this key held" needs no event iteration. The pressed and
+ * released sets cover the last zPollEvents, with a threaded queue every
+ * poll since the consumer's previous zGetInputSnapshot.
+ */
+typedef struct {
+    u64 keysDown[8]; // bit per ZKEY_* code
+    u64 keysPressed[8];
+    u64 keysReleased[8];
+    u32 buttonsDown; // bit per ZMOUSE_BUTTON_*
+    u32 buttonsPressed;
+    u32 buttonsReleased;
+    i32 mods; // ZKEY_MOD_* of the latest key or button event
+    f32 cursorX, cursorY;
+} ZInputState;
+
+/**
+ * Bump allocator over a single reservation, everything pushed is freed at
+ * once by resetting `used`
+ */
+typedef struct {
+    u8* base;
+    u64 size, used;
+    u64 committed; // bytes from base backed by memory, the rest is only reserved
+} ZArena;
+
+/**
+ * Recording appends every event the producer fills except user events,
+ * including the ones merged by coalescing and their text and dropped
+ * paths, to a file with a marker at the end of each zPollEvents, empty
+ * polls in a row sharing one. Replay maps such a file and feeds it back
+ * through the same path, while live input is dropped. Posted events and
+ * the window being closed still get through.
+ */
+typedef struct {
+    void* file; // log being recorded, NULL when not recording
+    ZEvent* buffer; // filled events not written to the file yet
+    u32 count;
+    u32 idleMarker; // buffer index + 1 of the marker ending the current run of empty polls, 0 when none
+    b32 pollRecorded; // something was recorded since the last marker
+
+    const ZEvent* replay; // events of the mapped log, NULL when not replaying
+    const void* replayMapping;
+    u64 replaySize; // size of the mapping in bytes
+    u64 replayCount, replayCursor;
+    u64 replayOrigin; // zGetTime when the log was recorded
+    u64 replayStart; // zGetTime when the replay began
+    i32 replayMode; // ZEVENT_REPLAY_*
+    u64 replayIdle; // empty recorded polls still to wait out in ZEVENT_REPLAY_FAST
+    b32 replayPumping; // set while _zPumpEventLog feeds the log in, live input is dropped otherwise
+} ZEventLog;
+
+/**
+ * Input and window events queue in separate lanes so a burst of window
+ * events can never push out or delay input. Draining empties the input
+ * lane first and keeps the order within each lane.
+ *
+ * The platform layer produces events and publishes them at the end of
+ * zPollEvents. When `threaded` is set, zPollEvents and the drain functions
+ * may run on different threads.
+ */
+typedef struct {
+    // Producer side
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) i32 overflow; // ZEVENT_OVERFLOW_*
+    u64 eventMask; // ZEVENT_MASK() of the types that get queued, backends may skip producing the rest
+    u64 coalesceMask; // ZEVENT_MASK() of the types merged into the newest pending event
+    u64 dropped; // events lost because the queue was full
+    u64 coalesced; // events merged into the newest pending event
+    u64 enqueued; // events that claimed a slot
+    u64 pollEnqueued; // enqueued when the current zPollEvents began
+    u64 highWaterMark;
+    u64 maxEventsPerPoll;
+    u64 typeEnqueued[64];
+    u64 typeCoalesced[64];
+    u64 typeDropped[64];
+    u64 time; // capture time of the message being translated, stamped on new events
+    u64 callbackMask; // ZEVENT_MASK() of the types dispatched to a callback instead of queued
+    b32 callbackPending; // callbackEvent is filled and waits to be dispatched
+    ZEvent callbackEvent;
+    ZEventHandler callbacks[64];
+    ZEvent* recordPending; // event being filled, appended to the recording at the next claim
+    ZInputState input;
+
+    b32 threaded;
+    ZEventLane lanes[ZEVENT_LANE_COUNT];
+
+    // Consumer side
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u32 peekLane; // lane exposed by the last zPeekEvents
+    u64 typeDrained[64];
+    u64 released[ZEVENT_LANE_COUNT]; // lane tails when the last drain call began, older payloads may be reused
+
+    // Copy of `input` a threaded queue publishes at the end of zPollEvents,
+    // guarded by a sequence counter that is odd while it is being written
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 inputSequence;
+    ZInputState inputPublished;
+
+    // Pressed and released sets a threaded queue gathers across polls,
+    // each zGetInputSnapshot takes and clears them
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 keysPressedPending[8];
+    u64 keysReleasedPending[8];
+    u64 buttonsPending; // pressed in the low half, released in the high half
+
+    // Events from zPostEvent, any thread may claim postHead while the
+    // producer drains from postTail into the lanes
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 postHead;
+    u64 postWake; // set once a poster woke the event loop, cleared when draining
+    ZZZ_ALIGN(ZZZ_CACHE_LINE_SIZE) u64 postTail;
+    ZPostedEvent posted[ZZZ_POSTED_EVENT_CAPACITY];
+
+    // Payload storage of the events, such as dropped file paths and text.
+    // Text offsets count from transient[0].base. A threaded queue moves to
+    // the other half only once the consumer released every event whose
+    // payload lives there, a single threaded one resets half 0 every poll.
+    ZArena transient[2];
+    u32 transientIndex; // half the producer allocates from
+    u64 transientRetired[2][ZEVENT_LANE_COUNT]; // lane write positions when the producer last left the half
+    ZEventLog log;
 } ZEventQueue;
 
 typedef struct {
@@ -164,6 +354,8 @@ typedef struct {
     HINSTANCE hInstance;
     HWND hWnd;
     ATOM mainWindowClass;
+#elif ZZZ_PLATFORM_LINUX
+    int wakeFd; // eventfd zPostEmptyEvent signals, the headless backend has no window
 #endif
 } ZSurface;
 
@@ -172,8 +364,34 @@ typedef struct {
     ZSurface surface;
 } ZZZ;
 
+/**
+ * A binding ties a key with modifiers, a mouse button or a scroll
+ * direction to an app defined action id. zCompileActionMap flattens a
+ * list of them into tables indexed by code and modifiers, so translating
+ * an event is a single load.
+ */
+typedef struct {
+    i32 type; // ZBINDING_*
+    i32 code; // ZKEY_*, ZMOUSE_BUTTON_* or ZSCROLL_*
+    i32 mods; // ZKEY_MOD_SHIFT/CONTROL/ALT/SUPER that must be held exactly, or ZBINDING_MODS_ANY
+    u16 action; // 0 is reserved for unbound
+} ZBinding;
+
+typedef struct {
+    u16 keys[16][512]; // [mods][ZKEY_*]
+    u16 buttons[16][8]; // [mods][ZMOUSE_BUTTON_*]
+    u16 scroll[4]; // [ZSCROLL_*], scroll events carry no modifiers
+    u16 heldKeys[512]; // action each key resolved to when it was pressed
+    u16 heldButtons[8];
+} ZActionMap;
+
 typedef struct {
     const char* name;
+    u32 eventQueueCapacity; // per lane, 0 means ZZZ_EVENT_QUEUE_CAPACITY
+    u32 eventQueueMaxCapacity; // per lane, 0 means ZZZ_EVENT_QUEUE_MAX_CAPACITY
+    i32 eventQueueOverflow; // ZEVENT_OVERFLOW_*, 0 means ZEVENT_OVERFLOW_GROW
+    b32 eventQueueThreaded; // zPollEvents and zNextEvent are called from different threads
+    b32 eventTypeArray; // keep a dense array of event types next to each lane to speed up zFindEvents
 #ifdef ZZZ_PLATFORM_DESKTOP
     u32 surfaceWidth, surfaceHeight;
 #endif
@@ -185,15 +403,46 @@ typedef struct {
 
 void* zMemReserve(u64 size);
 void zMemRelease(void* ptr);
+void* zMemReserveRange(u64 size);
+b32 zMemCommit(void* ptr, u64 nbytes);
+void zMemDecommit(void* ptr, u64 nbytes);
+b32 zMemProtect(void* ptr, u64 nbytes, u32 protect);
+u64 zMemGetPageSize(void);
 void zMemSet(void* dst, i32 value, u64 nbytes);
 void zMemZero(void* dst, u64 nbytes);
 void zMemCopy(void* dst, const void* src, u64 nbytes);
 
+u64 zGetTime(void);
+f64 zTimeToSeconds(u64 time, u64 origin);
+
 ZErr zInit(ZZZ* app, const ZZZInitInfo* info);
 void zSetWindowVisibility(ZZZ* app, b32 should_visible);
 void zTerminate(ZZZ* app);
 void zPollEvents(ZZZ* app);
+void zWaitEvents(ZZZ* app);
+void zWaitEventsTimeout(ZZZ* app, u64 timeout);
+void zPostEmptyEvent(ZZZ* app);
 b32 zNextEvent(ZZZ* app, ZEvent* event);
+u32 zNextEvents(ZZZ* app, ZEvent* events, u32 max);
+u32 zPeekEvents(ZZZ* app, const ZEvent** spanA, u32* countA, const ZEvent** spanB, u32* countB);
+void zConsumeEvents(ZZZ* app, u32 count);
+u32 zFindEvents(ZZZ* app, u64 typeMask, const ZEvent** events, u32 max);
+void zSetEventOverflowPolicy(ZZZ* app, i32 policy);
+void zSetEventCoalescing(ZZZ* app, i32 type, b32 enable);
+b32 zPostEvent(ZZZ* app, const ZEvent* event);
+void zSetEventMask(ZZZ* app, u64 mask);
+void zSetEventCallback(ZZZ* app, i32 type, ZEventCallback fn, void* user);
+ZErr zRecordBegin(ZZZ* app, const char* path);
+void zRecordEnd(ZZZ* app);
+ZErr zReplayBegin(ZZZ* app, const char* path, i32 mode);
+void zReplayEnd(ZZZ* app);
+b32 zIsReplaying(ZZZ* app);
+const char* zGetEventText(ZZZ* app, const ZEvent* event);
+b32 zGetKeyState(ZZZ* app, i32 key);
+void zGetInputSnapshot(ZZZ* app, ZInputState* state);
+void zGetEventStats(ZZZ* app, ZEventStats* stats);
+void zCompileActionMap(ZActionMap* map, const ZBinding* bindings, u32 count);
+u16 zGetEventAction(ZActionMap* map, const ZEvent* event);
 
 /** 
  * Enums
@@ -204,6 +453,10 @@ enum {
     ZERR_FAILED_TO_GET_WIN32_INSTANCE,
     ZERR_FAILED_TO_REGISTER_WIN32_WINDOW_CLASS,
     ZERR_FAILED_TO_CREATE_WIN32_WINDOW,
+    ZERR_FAILED_TO_RESERVE_MEMORY,
+    ZERR_FAILED_TO_OPEN_FILE,
+    ZERR_FAILED_TO_WRITE_FILE,
+    ZERR_INVALID_EVENT_LOG,
 };
 
 enum {
@@ -235,6 +488,29 @@ enum {
     ZEVENT_WINDOW_MAXIMIZED,
     ZEVENT_WINDOW_UNMAXIMIZED,
     ZEVENT_SCALE_CHANGED,
+    ZEVENT_TEXT_INPUT, // consecutive characters merged into one UTF-8 span
+
+    // Reserved for the application, see zPostEvent
+    ZEVENT_USER = 32,
+    ZEVENT_USER_LAST = 63,
+};
+
+#define ZEVENT_MASK(type) ((u64)1 << (type))
+#define ZEVENT_MASK_ALL (~(u64)0)
+
+/**
+ * What _zNewEvent does when a new event arrives at a full queue
+ */
+enum {
+    ZEVENT_OVERFLOW_GROW = 0, // double the capacity up to the max capacity, then drop the newest event. A threaded queue blocks the producer until a slot frees up instead
+    ZEVENT_OVERFLOW_DROP_NEWEST, // discard the incoming event
+    ZEVENT_OVERFLOW_DROP_OLDEST, // evict the oldest queued event to make room, a threaded queue drops the newest instead
+    ZEVENT_OVERFLOW_COALESCE, // overwrite the newest queued event if it has the same type, otherwise drop the incoming one
+};
+
+enum {
+    ZEVENT_REPLAY_FAST = 0, // one recorded zPollEvents worth of events per zPollEvents
+    ZEVENT_REPLAY_REALTIME, // every recorded zPollEvents whose time has come since the replay began
 };
 
 enum {
@@ -370,6 +646,44 @@ enum {
     ZKEY_MOD_NUM_LOCK = 0x0020,
 };
 
+enum {
+    ZMOUSE_BUTTON_1 = 0,
+    ZMOUSE_BUTTON_2 = 1,
+    ZMOUSE_BUTTON_3 = 2,
+    ZMOUSE_BUTTON_4 = 3,
+    ZMOUSE_BUTTON_5 = 4,
+    ZMOUSE_BUTTON_6 = 5,
+    ZMOUSE_BUTTON_7 = 6,
+    ZMOUSE_BUTTON_8 = 7,
+    ZMOUSE_BUTTON_LAST = ZMOUSE_BUTTON_8,
+    ZMOUSE_BUTTON_LEFT = ZMOUSE_BUTTON_1,
+    ZMOUSE_BUTTON_RIGHT = ZMOUSE_BUTTON_2,
+    ZMOUSE_BUTTON_MIDDLE = ZMOUSE_BUTTON_3,
+};
+
+enum {
+    ZSCROLL_UP = 0,
+    ZSCROLL_DOWN,
+    ZSCROLL_LEFT,
+    ZSCROLL_RIGHT,
+};
+
+enum {
+    ZBINDING_KEY = 0,
+    ZBINDING_MOUSE_BUTTON,
+    ZBINDING_SCROLL,
+};
+
+#define ZBINDING_MODS_ANY (-1)
+
+// Access flags for zMemProtect, write implies read
+enum {
+    ZMEM_PROTECT_NONE = 0,
+    ZMEM_PROTECT_READ = 0x1,
+    ZMEM_PROTECT_WRITE = 0x2,
+    ZMEM_PROTECT_READ_WRITE = ZMEM_PROTECT_READ | ZMEM_PROTECT_WRITE,
+};
+
 
 #ifdef __cplusplus
 }
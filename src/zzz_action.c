@@ -0,0 +1,112 @@
+#include "zzz.h"
+#include "zzz_internal.h"
+
+// Only these modifiers select a table row, lock keys never change an action
+#define _ZBINDING_MODS_MASK (ZKEY_MOD_SHIFT | ZKEY_MOD_CONTROL | ZKEY_MOD_ALT | ZKEY_MOD_SUPER)
+
+static void _zBindAction(ZActionMap* map, const ZBinding* binding, i32 mods)
+{
+    switch(binding->type) {
+        case ZBINDING_KEY:
+            {
+                if(binding->code >= 0 && binding->code < 512)
+                    map->keys[mods][binding->code] = binding->action;
+            } break;
+        case ZBINDING_MOUSE_BUTTON:
+            {
+                if(binding->code >= 0 && binding->code <= ZMOUSE_BUTTON_LAST)
+                    map->buttons[mods][binding->code] = binding->action;
+            } break;
+        case ZBINDING_SCROLL:
+            {
+                if(binding->code >= ZSCROLL_UP && binding->code <= ZSCROLL_RIGHT)
+                    map->scroll[binding->code] = binding->action;
+            } break;
+        default:
+            break;
+    }
+}
+
+// Rebuilds the tables from scratch, rebinding is just compiling again.
+// Bindings with exact modifiers take precedence over ZBINDING_MODS_ANY
+// ones, among equals the later binding wins. Keys held across a rebind
+// report no action on release.
+void zCompileActionMap(ZActionMap* map, const ZBinding* bindings, u32 count)
+{
+    if(!map)
+        return;
+    zMemZero(map, sizeof(ZActionMap));
+    if(!bindings)
+        return;
+
+    for(u32 i = 0; i < count; ++i) {
+        if(bindings[i].mods != ZBINDING_MODS_ANY)
+            continue;
+        for(i32 mods = 0; mods < 16; ++mods)
+            _zBindAction(map, bindings + i, mods);
+    }
+    for(u32 i = 0; i < count; ++i) {
+        if(bindings[i].mods == ZBINDING_MODS_ANY)
+            continue;
+        _zBindAction(map, bindings + i, bindings[i].mods & _ZBINDING_MODS_MASK);
+    }
+}
+
+// Returns the action bound to a key, mouse button or scroll event, 0 when
+// there is none. The event type still tells a press from a release. The
+// modifiers are only looked at on press, repeats and the release report
+// the action the press resolved to, so letting go of Ctrl before S still
+// ends the Ctrl+S action. Every press and release has to go through here
+// for that to hold.
+u16 zGetEventAction(ZActionMap* map, const ZEvent* event)
+{
+    if(!map || !event)
+        return 0;
+
+    switch(event->type) {
+        case ZEVENT_KEY_PRESSED:
+        case ZEVENT_KEY_REPEATED:
+        case ZEVENT_KEY_RELEASED:
+            {
+                // Unsigned compare also rejects ZKEY_UNKNOWN
+                const u32 key = (u32)event->keyboard.key;
+                if(key >= 512)
+                    return 0;
+                if(event->type == ZEVENT_KEY_PRESSED)
+                    map->heldKeys[key] = map->keys[event->keyboard.mods & _ZBINDING_MODS_MASK][key];
+                const u16 action = map->heldKeys[key];
+                if(event->type == ZEVENT_KEY_RELEASED)
+                    map->heldKeys[key] = 0;
+                return action;
+            } break;
+        case ZEVENT_BUTTON_PRESSED:
+        case ZEVENT_BUTTON_RELEASED:
+            {
+                const u32 button = (u32)event->mouse.button;
+                if(button > ZMOUSE_BUTTON_LAST)
+                    return 0;
+                if(event->type == ZEVENT_BUTTON_PRESSED)
+                    map->heldButtons[button] = map->buttons[event->mouse.mods & _ZBINDING_MODS_MASK][button];
+                const u16 action = map->heldButtons[button];
+                if(event->type == ZEVENT_BUTTON_RELEASED)
+                    map->heldButtons[button] = 0;
+                return action;
+            } break;
+        case ZEVENT_SCROLLED:
+            {
+                // The vertical axis wins when a coalesced event moved both
+                if(event->scroll.y > 0.0f)
+                    return map->scroll[ZSCROLL_UP];
+                if(event->scroll.y < 0.0f)
+                    return map->scroll[ZSCROLL_DOWN];
+                // Backends invert the horizontal axis, positive x is left
+                if(event->scroll.x > 0.0f)
+                    return map->scroll[ZSCROLL_LEFT];
+                if(event->scroll.x < 0.0f)
+                    return map->scroll[ZSCROLL_RIGHT];
+            } break;
+        default:
+            break;
+    }
+    return 0;
+}
@@ -1,23 +1,607 @@
 #include "zzz.h"
 #include "zzz_internal.h"
 
-ZEvent* _zNewEvent(ZEventQueue* eq, int type)
+// ZEvent must stay within 32 bytes, two events per cache line
+typedef char _zEventSizeCheck[(sizeof(ZEvent) <= 32) ? 1 : -1];
+
+static u64 _zRoundUpPow2(u64 n)
+{
+    u64 res = 1;
+    while(res < n)
+        res <<= 1;
+    return res;
+}
+
+// Types queued in the input lane, everything else goes to the window lane
+#define _ZEVENT_INPUT_LANE_MASK ( \
+        ZEVENT_MASK(ZEVENT_BUTTON_PRESSED) | \
+        ZEVENT_MASK(ZEVENT_BUTTON_RELEASED) | \
+        ZEVENT_MASK(ZEVENT_CURSOR_MOVED) | \
+        ZEVENT_MASK(ZEVENT_CURSOR_ENTERED) | \
+        ZEVENT_MASK(ZEVENT_CURSOR_LEFT) | \
+        ZEVENT_MASK(ZEVENT_SCROLLED) | \
+        ZEVENT_MASK(ZEVENT_KEY_PRESSED) | \
+        ZEVENT_MASK(ZEVENT_KEY_REPEATED) | \
+        ZEVENT_MASK(ZEVENT_KEY_RELEASED) | \
+        ZEVENT_MASK(ZEVENT_CODEPOINT_INPUT) | \
+        ZEVENT_MASK(ZEVENT_TEXT_INPUT))
+
+static ZEventLane* _zEventLane(ZEventQueue* eq, int type)
+{
+    return eq->lanes + (((_ZEVENT_INPUT_LANE_MASK >> type) & 1) ? ZEVENT_LANE_INPUT : ZEVENT_LANE_WINDOW);
+}
+
+static void _zEndRecording(ZEventQueue* eq);
+static void _zEndReplay(ZEventQueue* eq);
+
+static void _zCountDropped(ZEventQueue* eq, int type)
+{
+    eq->dropped++;
+    eq->typeDropped[type]++;
+}
+
+static void _zCountCoalesced(ZEventQueue* eq, int type)
+{
+    eq->coalesced++;
+    eq->typeCoalesced[type]++;
+}
+
+static void _zCountDrained(ZEventQueue* eq, const ZEvent* events, u64 count)
+{
+    for(u64 i = 0; i < count; ++i)
+        eq->typeDrained[events[i].type]++;
+}
+
+ZErr _zInitEventQueue(ZEventQueue* eq, const ZZZInitInfo* info)
+{
+    if(!eq || !info)
+        return ZERR_INVALID_ARGUMENTS;
+
+    u64 capacity = info->eventQueueCapacity ? info->eventQueueCapacity : ZZZ_EVENT_QUEUE_CAPACITY;
+    u64 maxCapacity = info->eventQueueMaxCapacity ? info->eventQueueMaxCapacity : ZZZ_EVENT_QUEUE_MAX_CAPACITY;
+    capacity = _zRoundUpPow2(capacity);
+    maxCapacity = _zRoundUpPow2(maxCapacity);
+    if(maxCapacity < capacity)
+        maxCapacity = capacity;
+
+    zMemZero(eq, sizeof(ZEventQueue));
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+        // Reserve the whole growth range up front and commit it as the ring
+        // grows into it
+        ZEventLane* lane = eq->lanes + i;
+        lane->events = zMemReserveRange(maxCapacity * sizeof(ZEvent));
+        if(!lane->events || !zMemCommit(lane->events, capacity * sizeof(ZEvent))) {
+            _zTerminateEventQueue(eq);
+            return ZERR_FAILED_TO_RESERVE_MEMORY;
+        }
+        if(info->eventTypeArray) {
+            lane->types = zMemReserveRange(maxCapacity);
+            if(!lane->types || !zMemCommit(lane->types, capacity)) {
+                _zTerminateEventQueue(eq);
+                return ZERR_FAILED_TO_RESERVE_MEMORY;
+            }
+        }
+        lane->capacity = capacity;
+        lane->mask = capacity - 1;
+        lane->maxCapacity = maxCapacity;
+    }
+    eq->transient[0].base = zMemReserveRange(2 * (u64)ZZZ_TRANSIENT_ARENA_SIZE);
+    if(!eq->transient[0].base) {
+        _zTerminateEventQueue(eq);
+        return ZERR_FAILED_TO_RESERVE_MEMORY;
+    }
+    eq->transient[0].size = ZZZ_TRANSIENT_ARENA_SIZE;
+    eq->transient[1].base = eq->transient[0].base + ZZZ_TRANSIENT_ARENA_SIZE;
+    eq->transient[1].size = ZZZ_TRANSIENT_ARENA_SIZE;
+    for(u64 i = 0; i < ZZZ_POSTED_EVENT_CAPACITY; ++i)
+        eq->posted[i].sequence = i;
+    eq->overflow = info->eventQueueOverflow;
+    eq->threaded = info->eventQueueThreaded;
+    eq->eventMask = ZEVENT_MASK_ALL;
+    eq->coalesceMask = ZEVENT_MASK(ZEVENT_CURSOR_MOVED) |
+        ZEVENT_MASK(ZEVENT_SCROLLED) |
+        ZEVENT_MASK(ZEVENT_WINDOW_RESIZED) |
+        ZEVENT_MASK(ZEVENT_FRAMEBUFFER_RESIZED);
+    return ZERR_NONE;
+}
+
+void _zTerminateEventQueue(ZEventQueue* eq)
 {
     if(!eq)
+        return;
+    _zEndRecording(eq);
+    _zEndReplay(eq);
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+        if(eq->lanes[i].events)
+            zMemRelease(eq->lanes[i].events);
+        if(eq->lanes[i].types)
+            zMemRelease(eq->lanes[i].types);
+    }
+    if(eq->transient[0].base)
+        zMemRelease(eq->transient[0].base);
+    zMemZero(eq, sizeof(ZEventQueue));
+}
+
+// Writes out the buffered part of the recording, a failed write ends it
+static void _zWriteEventLog(ZEventQueue* eq)
+{
+    ZEventLog* log = &eq->log;
+    u32 count = log->count;
+    log->count = 0;
+    log->idleMarker = 0;
+    if(count && !_zPlatformWriteFile(log->file, log->buffer, count * sizeof(ZEvent)))
+        _zEndRecording(eq);
+}
+
+// Next free entry of the recording buffer, NULL once a failed write ended
+// the recording
+static ZEvent* _zRecordSlot(ZEventQueue* eq)
+{
+    ZEventLog* log = &eq->log;
+    if(log->count == ZZZ_EVENT_LOG_BUFFER_CAPACITY)
+        _zWriteEventLog(eq);
+    if(!log->file)
+        return NULL;
+    log->pollRecorded = TRUE;
+    return log->buffer + log->count++;
+}
+
+// Appends size bytes to the payload that follows the last recorded event,
+// offset counts the bytes of it written so far. Entries are zero filled
+// as they are claimed, so the payload ends up padded to whole entries.
+static void _zRecordBytes(ZEventQueue* eq, const void* data, u64 size, u64* offset)
+{
+    ZEventLog* log = &eq->log;
+    const u8* src = data;
+    while(size && log->file) {
+        u64 at = *offset % sizeof(ZEvent);
+        if(!at) {
+            ZEvent* slot = _zRecordSlot(eq);
+            if(!slot)
+                return;
+            zMemZero(slot, sizeof(ZEvent));
+        }
+        u64 n = sizeof(ZEvent) - at;
+        if(n > size)
+            n = size;
+        zMemCopy((u8*)(log->buffer + log->count - 1) + at, src, n);
+        src += n;
+        size -= n;
+        *offset += n;
+    }
+}
+
+static u64 _zStringLength(const char* str)
+{
+    u64 length = 0;
+    while(str[length])
+        length++;
+    return length;
+}
+
+// Appends the event filled since the last claim to the recording, called
+// before the next claim or flush once the caller is done writing it. Text
+// and dropped paths live outside the event, so they follow it as
+// NUL terminated bytes. User events are left out, whatever posts them
+// posts them again during a replay.
+static void _zRecordEvent(ZEventQueue* eq)
+{
+    const ZEvent* ev = eq->recordPending;
+    eq->recordPending = NULL;
+    if(ev->type >= ZEVENT_USER)
+        return;
+    ZEvent* slot = _zRecordSlot(eq);
+    if(!slot)
+        return;
+    *slot = *ev;
+
+    u64 offset = 0;
+    if(ev->type == ZEVENT_TEXT_INPUT) {
+        _zRecordBytes(eq, eq->transient[0].base + ev->text.offset, (u64)ev->text.length + 1, &offset);
+    } else if(ev->type == ZEVENT_FILE_DROPPED) {
+        // The pointer means nothing to a replay, its place holds the size
+        // of the paths instead
+        u64 size = 0;
+        for(i32 i = 0; ev->file.paths && i < ev->file.count; ++i)
+            size += _zStringLength(ev->file.paths[i]) + 1;
+        slot->file.paths = NULL;
+        slot->text.length = (u32)size;
+        for(i32 i = 0; ev->file.paths && i < ev->file.count; ++i)
+            _zRecordBytes(eq, ev->file.paths[i], _zStringLength(ev->file.paths[i]) + 1, &offset);
+    }
+}
+
+// Cold path of _zNewEvent, only called with a full lane. Doubles the
+// capacity in place, the live events stay where they are except for the
+// shorter of the two wrapped segments which is unrolled past the old end.
+// Moves the tail, so never valid for a threaded queue.
+static b32 _zGrowEventLane(ZEventQueue* eq, ZEventLane* lane)
+{
+    if(eq->threaded || lane->capacity >= lane->maxCapacity)
+        return FALSE;
+    u64 oldCapacity = lane->capacity;
+    if(!zMemCommit(lane->events + oldCapacity, oldCapacity * sizeof(ZEvent)))
+        return FALSE;
+    if(lane->types && !zMemCommit(lane->types + oldCapacity, oldCapacity))
+        return FALSE;
+    // The pending event is about to move
+    if(eq->recordPending)
+        _zRecordEvent(eq);
+
+    u64 t = lane->tail & lane->mask;
+    // Oldest events live in [t, oldCapacity), newest in [0, t)
+    if(t < oldCapacity - t) {
+        zMemCopy(lane->events + oldCapacity, lane->events, t * sizeof(ZEvent));
+        if(lane->types)
+            zMemCopy(lane->types + oldCapacity, lane->types, t);
+        lane->tail = t;
+    } else {
+        zMemCopy(lane->events + oldCapacity + t, lane->events + t, (oldCapacity - t) * sizeof(ZEvent));
+        if(lane->types)
+            zMemCopy(lane->types + oldCapacity + t, lane->types + t, oldCapacity - t);
+        lane->tail = oldCapacity + t;
+    }
+    lane->write = lane->tail + oldCapacity;
+    lane->head = lane->write;
+    lane->cachedTail = lane->tail;
+    lane->capacity = oldCapacity * 2;
+    lane->mask = lane->capacity - 1;
+    return TRUE;
+}
+
+// Newest pending event the producer may still modify or NULL. A threaded
+// queue only allows unpublished events since the consumer may be reading
+// the published ones.
+static ZEvent* _zLastEvent(ZEventQueue* eq, ZEventLane* lane)
+{
+    u64 oldest = eq->threaded ? lane->head : lane->tail;
+    if(lane->write == oldest)
         return NULL;
+    return lane->events + ((lane->write - 1) & lane->mask);
+}
 
-    ZEvent* ev = eq->events + eq->head;
-    eq->head = (eq->head + 1) % ZZZ_EVENT_QUEUE_CAPACITY;
-    if(eq->head == eq->tail)
+// Cold path of _zNewEvent, picks the slot for an event arriving at a full
+// lane according to the overflow policy or returns NULL to drop it. Sets
+// reused when it hands back a slot that already holds a counted event.
+static ZEvent* _zOverflowEvent(ZEventQueue* eq, ZEventLane* lane, int type, b32* reused)
+{
+    switch(eq->overflow) {
+        case ZEVENT_OVERFLOW_GROW:
+            {
+                if(eq->threaded) {
+                    // Publish what we have so the consumer can drain it, then
+                    // wait for it to free a slot
+                    _zFlushEvents(eq);
+                    do {
+                        _zPlatformYield();
+                        lane->cachedTail = _zAtomicLoad64(&lane->tail);
+                    } while(lane->write - lane->cachedTail == lane->capacity);
+                } else if(!_zGrowEventLane(eq, lane)) {
+                    _zCountDropped(eq, type);
+                    return NULL;
+                }
+            } break;
+        case ZEVENT_OVERFLOW_DROP_OLDEST:
+            {
+                if(eq->threaded) {
+                    _zCountDropped(eq, type);
+                    return NULL;
+                }
+                _zCountDropped(eq, lane->events[lane->tail & lane->mask].type);
+                lane->tail++;
+                lane->cachedTail = lane->tail;
+            } break;
+        case ZEVENT_OVERFLOW_COALESCE:
+            {
+                ZEvent* last = _zLastEvent(eq, lane);
+                if(!last || last->type != type) {
+                    _zCountDropped(eq, type);
+                    return NULL;
+                }
+                // The event takes over the slot of the last one, which was
+                // already counted as enqueued
+                _zCountCoalesced(eq, type);
+                *reused = TRUE;
+                return last;
+            } break;
+        case ZEVENT_OVERFLOW_DROP_NEWEST:
+        default:
+            {
+                _zCountDropped(eq, type);
+                return NULL;
+            } break;
+    }
+
+    ZEvent* ev = lane->events + (lane->write & lane->mask);
+    lane->write++;
+    return ev;
+}
+
+// Claims a slot for a new event, it stays private to the producer until
+// the next _zFlushEvents. Types with a callback get a scratch event
+// instead, dispatched once the caller is done filling it.
+// Types a replay lets through live, the log has no user events and the
+// app must stay closable
+#define _ZEVENT_REPLAY_LIVE_MASK (ZEVENT_MASK(ZEVENT_WINDOW_CLOSED) | ~(ZEVENT_MASK(ZEVENT_USER) - 1))
+
+// TRUE for a live event a running replay stands in for
+static b32 _zReplayMasked(const ZEventQueue* eq, int type)
+{
+    return eq->log.replay && !eq->log.replayPumping && !(_ZEVENT_REPLAY_LIVE_MASK & ZEVENT_MASK(type));
+}
+
+ZEvent* _zNewEvent(ZEventQueue* eq, int type)
+{
+    if(!eq)
+        return NULL;
+    if(eq->recordPending)
+        _zRecordEvent(eq);
+    if(eq->callbackPending)
+        _zDispatchEventCallback(eq);
+    if(!(eq->eventMask & ZEVENT_MASK(type)))
         return NULL;
+    if(_zReplayMasked(eq, type)) {
+        _zCountDropped(eq, type);
+        return NULL;
+    }
+
+    ZEvent* ev;
+    if(eq->callbackMask & ZEVENT_MASK(type)) {
+        ev = &eq->callbackEvent;
+        eq->callbackPending = TRUE;
+    } else {
+        ZEventLane* lane = _zEventLane(eq, type);
+        if(lane->write - lane->cachedTail == lane->capacity)
+            lane->cachedTail = _zAtomicLoad64(&lane->tail);
+        b32 reused = FALSE;
+        if(lane->write - lane->cachedTail != lane->capacity) {
+            ev = lane->events + (lane->write & lane->mask);
+            lane->write++;
+        } else {
+            ev = _zOverflowEvent(eq, lane, type, &reused);
+            if(!ev)
+                return NULL;
+        }
+        if(!reused) {
+            if(lane->types)
+                lane->types[ev - lane->events] = (u8)type;
+            eq->enqueued++;
+            eq->typeEnqueued[type]++;
+        }
+    }
 
     zMemZero(ev, sizeof(ZEvent));
     ev->type = type;
+    ev->time = eq->time;
+    if(eq->log.file)
+        eq->recordPending = ev;
     return ev;
 }
 
+// Copies the input state for a threaded consumer, which reads it through
+// the sequence counter and retries if it changed meanwhile. The pressed and
+// released sets are added to the pending ones afterwards, so no poll the
+// consumer skipped loses them and a snapshot that took them also sees the
+// copy they belong to.
+static void _zPublishInputState(ZEventQueue* eq)
+{
+    ZInputState* input = &eq->input;
+    u64 sequence = eq->inputSequence;
+    _zAtomicStore64(&eq->inputSequence, sequence + 1);
+    _zAtomicFence();
+    zMemCopy(&eq->inputPublished, input, sizeof(ZInputState));
+    _zAtomicStore64(&eq->inputSequence, sequence + 2);
+
+    for(u32 i = 0; i < 8; ++i) {
+        if(input->keysPressed[i])
+            _zAtomicOr64(&eq->keysPressedPending[i], input->keysPressed[i]);
+        if(input->keysReleased[i])
+            _zAtomicOr64(&eq->keysReleasedPending[i], input->keysReleased[i]);
+    }
+    if(input->buttonsPressed || input->buttonsReleased)
+        _zAtomicOr64(&eq->buttonsPending, (u64)input->buttonsPressed | ((u64)input->buttonsReleased << 32));
+}
+
+// Publishes the events claimed since the last flush to the consumer
+void _zFlushEvents(ZEventQueue* eq)
+{
+    if(!eq)
+        return;
+    if(eq->recordPending)
+        _zRecordEvent(eq);
+    if(eq->callbackPending)
+        _zDispatchEventCallback(eq);
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+        ZEventLane* lane = eq->lanes + i;
+        if(lane->head != lane->write) {
+            _zAtomicStore64(&lane->head, lane->write);
+            // The lane is at its fullest right before the app drains it
+            u64 pending = lane->write - _zAtomicLoad64(&lane->tail);
+            if(pending > eq->highWaterMark)
+                eq->highWaterMark = pending;
+        }
+    }
+    if(eq->enqueued - eq->pollEnqueued > eq->maxEventsPerPoll)
+        eq->maxEventsPerPoll = eq->enqueued - eq->pollEnqueued;
+    if(eq->threaded)
+        _zPublishInputState(eq);
+}
+
+// Hands the scratch event filled since the last _zNewEvent to its
+// callback, backends call this at the end of each OS message so handlers
+// run inside the message dispatch
+void _zDispatchEventCallback(ZEventQueue* eq)
+{
+    if(!eq || !eq->callbackPending)
+        return;
+    eq->callbackPending = FALSE;
+    ZEventHandler* handler = eq->callbacks + eq->callbackEvent.type;
+    if(handler->fn)
+        handler->fn(&eq->callbackEvent, handler->user);
+}
+
+// Called by the backend before translating any message, frees the payload
+// data of the events handed out by the previous zPollEvents. A threaded
+// consumer may still be reading those, so the producer switches halves
+// only once the consumer released every event of the other half and keeps
+// appending to the current one until then.
+void _zBeginPollEvents(ZEventQueue* eq)
+{
+    if(!eq)
+        return;
+    eq->pollEnqueued = eq->enqueued;
+    if(eq->threaded) {
+        u32 other = eq->transientIndex ^ 1;
+        b32 released = TRUE;
+        for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+            if(_zAtomicLoad64(&eq->released[i]) < eq->transientRetired[other][i])
+                released = FALSE;
+        }
+        if(released) {
+            for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i)
+                eq->transientRetired[eq->transientIndex][i] = eq->lanes[i].write;
+            eq->transientIndex = other;
+            eq->transient[other].used = 0;
+        }
+    } else {
+        eq->transient[0].used = 0;
+    }
+    zMemZero(eq->input.keysPressed, sizeof(eq->input.keysPressed));
+    zMemZero(eq->input.keysReleased, sizeof(eq->input.keysReleased));
+    eq->input.buttonsPressed = 0;
+    eq->input.buttonsReleased = 0;
+}
+
+// Arenas are reserved whole and committed in steps of this many bytes
+#define _ZARENA_COMMIT_SIZE (64 << 10)
+
+// Returns size bytes aligned to align, a power of two, or NULL once the
+// arena is full
+void* _zArenaPush(ZArena* arena, u64 size, u64 align)
+{
+    u64 offset = (arena->used + align - 1) & ~(align - 1);
+    if(offset > arena->size || size > arena->size - offset)
+        return NULL;
+    if(offset + size > arena->committed) {
+        u64 committed = (offset + size + _ZARENA_COMMIT_SIZE - 1) & ~(u64)(_ZARENA_COMMIT_SIZE - 1);
+        if(committed > arena->size)
+            committed = arena->size;
+        if(!zMemCommit(arena->base + arena->committed, committed - arena->committed))
+            return NULL;
+        arena->committed = committed;
+    }
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+// Moves the events posted from other threads into the ring, called by the
+// producer so the ring itself keeps a single producer
+void _zPumpPostedEvents(ZEventQueue* eq)
+{
+    if(!eq)
+        return;
+
+    // Clear before draining, anything posted after this wakes us again
+    _zAtomicExchange64(&eq->postWake, 0);
+    for(;;) {
+        ZPostedEvent* cell = eq->posted + (eq->postTail & (ZZZ_POSTED_EVENT_CAPACITY - 1));
+        if(_zAtomicLoad64(&cell->sequence) != eq->postTail + 1)
+            break;
+
+        ZEvent* ev = _zNewEvent(eq, cell->event.type);
+        if(ev)
+            *ev = cell->event;
+        _zAtomicStore64(&cell->sequence, eq->postTail + ZZZ_POSTED_EVENT_CAPACITY);
+        eq->postTail++;
+    }
+}
+
+// Records the result of merging into an already claimed event again, so a
+// replay merges the same way
+static void _zRecordMerge(ZEventQueue* eq, ZEvent* ev)
+{
+    if(!eq->log.file)
+        return;
+    if(eq->recordPending && eq->recordPending != ev)
+        _zRecordEvent(eq);
+    eq->recordPending = ev;
+}
+
+// Returns the newest pending event when it has the given type and that
+// type is coalesced, so the caller can merge into it instead of queueing
+static ZEvent* _zCoalesceEvent(ZEventQueue* eq, int type)
+{
+    if(!eq || !(eq->coalesceMask & eq->eventMask & ~eq->callbackMask & ZEVENT_MASK(type)) ||
+            _zReplayMasked(eq, type))
+        return NULL;
+    ZEvent* last = _zLastEvent(eq, _zEventLane(eq, type));
+    if(!last || last->type != type)
+        return NULL;
+    _zCountCoalesced(eq, type);
+    last->time = eq->time;
+    _zRecordMerge(eq, last);
+    return last;
+}
+
+#define _ZKEY_COUNT 512
+
+// Updates the key bitsets and returns the action to report, pressing a
+// key that is already down is a repeat. Releasing one that is not down
+// returns ZEVENT_UNKNOWN, there is nothing to report.
+static i32 _zTrackKey(ZInputState* state, i32 key, i32 action, i32 mods)
+{
+    state->mods = mods;
+    if(key < 0 || key >= _ZKEY_COUNT)
+        return action;
+    const u32 word = (u32)key >> 6;
+    const u64 bit = (u64)1 << (key & 63);
+    if(action == ZEVENT_KEY_PRESSED) {
+        if(state->keysDown[word] & bit)
+            return ZEVENT_KEY_REPEATED;
+        state->keysDown[word] |= bit;
+        state->keysPressed[word] |= bit;
+    } else if(action == ZEVENT_KEY_RELEASED) {
+        if(!(state->keysDown[word] & bit))
+            return ZEVENT_UNKNOWN;
+        state->keysDown[word] &= ~bit;
+        state->keysReleased[word] |= bit;
+    }
+    return action;
+}
+
+// Same for buttons, returns FALSE for the release of a button that is not
+// down
+static b32 _zTrackMouseButton(ZInputState* state, i32 button, i32 action, i32 mods)
+{
+    state->mods = mods;
+    if(button < 0 || button > ZMOUSE_BUTTON_LAST)
+        return TRUE;
+    const u32 bit = 1u << button;
+    if(action == ZEVENT_BUTTON_PRESSED) {
+        state->buttonsDown |= bit;
+        state->buttonsPressed |= bit;
+    } else {
+        if(!(state->buttonsDown & bit))
+            return FALSE;
+        state->buttonsDown &= ~bit;
+        state->buttonsReleased |= bit;
+    }
+    return TRUE;
+}
+
 void _zInputKey(ZEventQueue* eq, i32 key, i32 scancode, i32 action, i32 mods)
 {
+   if(!eq)
+       return;
+   // The state follows every key, even the ones masked out of the queue.
+   // A replay drives it from the log instead.
+   if(!eq->log.replay) {
+       action = _zTrackKey(&eq->input, key, action, mods);
+       if(action == ZEVENT_UNKNOWN)
+           return;
+   }
+   if(!(eq->eventMask & ZEVENT_MASK(action)))
+       return;
    ZEvent* ev = _zNewEvent(eq, action);
    if(!ev)
        return;
@@ -26,14 +610,981 @@ void _zInputKey(ZEventQueue* eq, i32 key, i32 scancode, i32 action, i32 mods)
    ev->keyboard.mods = mods;
 }
 
+static u32 _zEncodeUtf8(u32 codepoint, u8* out)
+{
+    if(codepoint < 0x80) {
+        out[0] = (u8)codepoint;
+        return 1;
+    } else if(codepoint < 0x800) {
+        out[0] = (u8)(0xc0 | (codepoint >> 6));
+        out[1] = (u8)(0x80 | (codepoint & 0x3f));
+        return 2;
+    } else if(codepoint < 0x10000) {
+        if(codepoint >= 0xd800 && codepoint <= 0xdfff)
+            return 0;
+        out[0] = (u8)(0xe0 | (codepoint >> 12));
+        out[1] = (u8)(0x80 | ((codepoint >> 6) & 0x3f));
+        out[2] = (u8)(0x80 | (codepoint & 0x3f));
+        return 3;
+    } else if(codepoint < 0x110000) {
+        out[0] = (u8)(0xf0 | (codepoint >> 18));
+        out[1] = (u8)(0x80 | ((codepoint >> 12) & 0x3f));
+        out[2] = (u8)(0x80 | ((codepoint >> 6) & 0x3f));
+        out[3] = (u8)(0x80 | (codepoint & 0x3f));
+        return 4;
+    }
+    return 0;
+}
+
+// Appends a character to the text of the newest pending ZEVENT_TEXT_INPUT
+// when it still ends the transient arena, otherwise starts a new one. The
+// text is kept NUL terminated, merging writes over the terminator.
+void _zInputCodepoint(ZEventQueue* eq, u32 codepoint)
+{
+    if(!eq || !(eq->eventMask & ZEVENT_MASK(ZEVENT_TEXT_INPUT)))
+        return;
+    if(_zReplayMasked(eq, ZEVENT_TEXT_INPUT)) {
+        _zCountDropped(eq, ZEVENT_TEXT_INPUT);
+        return;
+    }
+
+    u8 utf8[4];
+    u32 length = _zEncodeUtf8(codepoint, utf8);
+    if(!length)
+        return;
+
+    ZArena* arena = _zTransientArena(eq);
+    if(!(eq->callbackMask & ZEVENT_MASK(ZEVENT_TEXT_INPUT))) {
+        ZEvent* last = _zLastEvent(eq, eq->lanes + ZEVENT_LANE_INPUT);
+        if(last && last->type == ZEVENT_TEXT_INPUT &&
+                eq->transient[0].base + last->text.offset + last->text.length + 1 == arena->base + arena->used) {
+            arena->used--;
+            u8* dst = _zArenaPush(arena, length + 1, 1);
+            if(!dst) {
+                arena->used++;
+                _zCountDropped(eq, ZEVENT_TEXT_INPUT);
+                return;
+            }
+            zMemCopy(dst, utf8, length);
+            dst[length] = 0;
+            last->text.length += length;
+            last->time = eq->time;
+            _zCountCoalesced(eq, ZEVENT_TEXT_INPUT);
+            _zRecordMerge(eq, last);
+            return;
+        }
+    }
+
+    u64 used = arena->used;
+    u8* dst = _zArenaPush(arena, length + 1, 1);
+    if(!dst) {
+        _zCountDropped(eq, ZEVENT_TEXT_INPUT);
+        return;
+    }
+    ZEvent* ev = _zNewEvent(eq, ZEVENT_TEXT_INPUT);
+    if(!ev) {
+        arena->used = used;
+        return;
+    }
+    zMemCopy(dst, utf8, length);
+    dst[length] = 0;
+    ev->text.offset = (u32)(dst - eq->transient[0].base);
+    ev->text.length = length;
+}
+
+void _zInputMouseButton(ZEventQueue* eq, i32 button, i32 action, i32 mods)
+{
+    if(!eq)
+        return;
+    if(!eq->log.replay && !_zTrackMouseButton(&eq->input, button, action, mods))
+        return;
+    ZEvent* ev = _zNewEvent(eq, action);
+    if(!ev)
+        return;
+    ev->mouse.button = button;
+    ev->mouse.mods = mods;
+}
+
+// Releases every key and button still held, backends call this when the
+// window loses focus since the releases then go to another window
+void _zInputReleaseAll(ZEventQueue* eq)
+{
+    if(!eq)
+        return;
+    const i32 mods = eq->input.mods;
+    for(u32 word = 0; word < 8; ++word) {
+        u64 bits = eq->input.keysDown[word];
+        while(bits) {
+            const u32 bit = _zCountTrailingZeros64(bits);
+            bits &= bits - 1;
+            _zInputKey(eq, (i32)(word * 64 + bit), 0, ZEVENT_KEY_RELEASED, mods);
+        }
+    }
+    u64 buttons = eq->input.buttonsDown;
+    while(buttons) {
+        const u32 button = _zCountTrailingZeros64(buttons);
+        buttons &= buttons - 1;
+        _zInputMouseButton(eq, (i32)button, ZEVENT_BUTTON_RELEASED, mods);
+    }
+}
+
+void _zInputCursorPos(ZEventQueue* eq, f32 x, f32 y)
+{
+    if(!eq)
+        return;
+    if(!eq->log.replay) {
+        eq->input.cursorX = x;
+        eq->input.cursorY = y;
+    }
+    ZEvent* ev = _zCoalesceEvent(eq, ZEVENT_CURSOR_MOVED);
+    if(!ev)
+        ev = _zNewEvent(eq, ZEVENT_CURSOR_MOVED);
+    if(!ev)
+        return;
+    ev->cursor.x = x;
+    ev->cursor.y = y;
+}
+
+void _zInputScroll(ZEventQueue* eq, f32 dx, f32 dy)
+{
+    ZEvent* ev = _zCoalesceEvent(eq, ZEVENT_SCROLLED);
+    if(ev) {
+        ev->scroll.x += dx;
+        ev->scroll.y += dy;
+        return;
+    }
+    ev = _zNewEvent(eq, ZEVENT_SCROLLED);
+    if(!ev)
+        return;
+    ev->scroll.x = dx;
+    ev->scroll.y = dy;
+}
+
+void _zInputWindowSize(ZEventQueue* eq, i32 width, i32 height)
+{
+    ZEvent* ev = _zCoalesceEvent(eq, ZEVENT_WINDOW_RESIZED);
+    if(!ev)
+        ev = _zNewEvent(eq, ZEVENT_WINDOW_RESIZED);
+    if(!ev)
+        return;
+    ev->window.width = width;
+    ev->window.height = height;
+}
+
+void _zInputFramebufferSize(ZEventQueue* eq, i32 width, i32 height)
+{
+    ZEvent* ev = _zCoalesceEvent(eq, ZEVENT_FRAMEBUFFER_RESIZED);
+    if(!ev)
+        ev = _zNewEvent(eq, ZEVENT_FRAMEBUFFER_RESIZED);
+    if(!ev)
+        return;
+    ev->size.width = width;
+    ev->size.height = height;
+}
+
+// Called once at the start of every drain call. A threaded queue hands
+// the payloads of the events drained before back to the producer, a single
+// threaded queue publishes on demand so events produced outside
+// zPollEvents show up too, flushing only when something is unpublished.
+static void _zBeginDrain(ZEventQueue* eq)
+{
+    if(eq->threaded) {
+        for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i)
+            _zAtomicStore64(&eq->released[i], eq->lanes[i].tail);
+        return;
+    }
+    if(eq->recordPending || eq->callbackPending ||
+            eq->lanes[ZEVENT_LANE_INPUT].write != eq->lanes[ZEVENT_LANE_INPUT].head ||
+            eq->lanes[ZEVENT_LANE_WINDOW].write != eq->lanes[ZEVENT_LANE_WINDOW].head)
+        _zFlushEvents(eq);
+}
+
+// Consumer side view of the published events
+static u64 _zAcquireHead(ZEventLane* lane)
+{
+    return _zAtomicLoad64(&lane->head);
+}
+
 b32 zNextEvent(ZZZ *app, ZEvent *ev)
 {
     if(!ev || !app)
         return FALSE;
+    ZEventQueue* eq = &app->eq;
+    _zBeginDrain(eq);
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+        ZEventLane* lane = eq->lanes + i;
+        if(_zAcquireHead(lane) != lane->tail) {
+            *ev = lane->events[lane->tail & lane->mask];
+            eq->typeDrained[ev->type]++;
+            _zAtomicStore64(&lane->tail, lane->tail + 1);
+            return ev->type != ZEVENT_UNKNOWN;
+        }
+    }
     zMemZero(ev, sizeof(ZEvent));
-    if(app->eq.head != app->eq.tail) {
-        *ev = app->eq.events[app->eq.tail];
-        app->eq.tail = (app->eq.tail + 1) % ZZZ_EVENT_QUEUE_CAPACITY;
+    return FALSE;
+}
+
+// Drains up to max events into the array, the input lane first, with at
+// most two copies per lane, one for each contiguous span of its ring.
+// Returns the number of events written.
+u32 zNextEvents(ZZZ* app, ZEvent* events, u32 max)
+{
+    if(!app || !events)
+        return 0;
+
+    ZEventQueue* eq = &app->eq;
+    _zBeginDrain(eq);
+    u64 total = 0;
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT && total < max; ++i) {
+        ZEventLane* lane = eq->lanes + i;
+        u64 count = _zAcquireHead(lane) - lane->tail;
+        if(count > max - total)
+            count = max - total;
+
+        u64 first = lane->tail & lane->mask;
+        u64 firstCount = lane->capacity - first;
+        if(firstCount > count)
+            firstCount = count;
+        zMemCopy(events + total, lane->events + first, firstCount * sizeof(ZEvent));
+        zMemCopy(events + total + firstCount, lane->events, (count - firstCount) * sizeof(ZEvent));
+        _zCountDrained(eq, events + total, count);
+        _zAtomicStore64(&lane->tail, lane->tail + count);
+        total += count;
+    }
+    return (u32)total;
+}
+
+// Exposes the pending events of the first non-empty lane in place as two
+// spans in queue order, the second one is empty unless the events wrap
+// around the end of the ring. zConsumeEvents consumes from that same lane,
+// so peeking until it returns 0 visits the input lane first. The spans
+// stay valid until the next zConsumeEvents or zPollEvents.
+// Returns the total number of events in the spans.
+u32 zPeekEvents(ZZZ* app, const ZEvent** spanA, u32* countA, const ZEvent** spanB, u32* countB)
+{
+    if(!app || !spanA || !countA || !spanB || !countB)
+        return 0;
+
+    ZEventQueue* eq = &app->eq;
+    _zBeginDrain(eq);
+    ZEventLane* lane = eq->lanes;
+    u64 count = 0;
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT; ++i) {
+        lane = eq->lanes + i;
+        eq->peekLane = i;
+        count = _zAcquireHead(lane) - lane->tail;
+        if(count)
+            break;
+    }
+
+    u64 first = lane->tail & lane->mask;
+    u64 firstCount = lane->capacity - first;
+    if(firstCount > count)
+        firstCount = count;
+
+    *spanA = lane->events + first;
+    *countA = (u32)firstCount;
+    *spanB = lane->events;
+    *countB = (u32)(count - firstCount);
+    return (u32)count;
+}
+
+void zConsumeEvents(ZZZ* app, u32 count)
+{
+    if(!app)
+        return;
+    ZEventQueue* eq = &app->eq;
+    ZEventLane* lane = eq->lanes + eq->peekLane;
+    u64 pending = _zAcquireHead(lane) - lane->tail;
+    if(count > pending)
+        count = (u32)pending;
+    u64 first = lane->tail & lane->mask;
+    u64 firstCount = lane->capacity - first;
+    if(firstCount > count)
+        firstCount = count;
+    _zCountDrained(eq, lane->events + first, firstCount);
+    _zCountDrained(eq, lane->events, count - firstCount);
+    _zAtomicStore64(&lane->tail, lane->tail + count);
+}
+
+// Collects the indices in [start, count) whose type is set in typeMask,
+// appending to the n already found
+static u32 _zScanEventTypesScalar(const u8* types, u64 start, u64 count, u64 typeMask, u64* indices, u32 n, u32 max)
+{
+    for(u64 i = start; i < count && n < max; ++i) {
+        if((typeMask >> types[i]) & 1)
+            indices[n++] = i;
+    }
+    return n;
+}
+
+#if ZZZ_ARCH_X64
+
+// Past this many types in the mask one compare per type costs more than
+// the scalar bit test
+#define _ZFIND_SSE2_MAX_TYPES 8
+
+// Every type in the mask is compared against 16 types at a time
+static u32 _zScanEventTypesSse2(const u8* types, u64 count, u64 typeMask, u64* indices, u32 max)
+{
+    u32 n = 0;
+    u64 i = 0;
+    __m128i needles[_ZFIND_SSE2_MAX_TYPES];
+    u32 needleCount = 0;
+    for(u64 m = typeMask; m; m &= m - 1) {
+        if(needleCount == _ZFIND_SSE2_MAX_TYPES)
+            return _zScanEventTypesScalar(types, 0, count, typeMask, indices, 0, max);
+        needles[needleCount++] = _mm_set1_epi8((char)_zCountTrailingZeros64(m));
+    }
+
+    for(; i + 16 <= count && n < max; i += 16) {
+        __m128i t = _mm_loadu_si128((const __m128i*)(types + i));
+        __m128i hit = _mm_setzero_si128();
+        for(u32 k = 0; k < needleCount; ++k)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(t, needles[k]));
+        u64 bits = (u32)_mm_movemask_epi8(hit);
+        for(; bits && n < max; bits &= bits - 1)
+            indices[n++] = i + _zCountTrailingZeros64(bits);
+    }
+    return _zScanEventTypesScalar(types, i, count, typeMask, indices, n, max);
+}
+
+// The type mask is a bit table looked up 32 types at a time, independent
+// of how many types it holds
+ZZZ_TARGET_AVX2 static u32 _zScanEventTypesAvx2(const u8* types, u64 count, u64 typeMask, u64* indices, u32 max)
+{
+    u32 n = 0;
+    u64 i = 0;
+    // Bytes 0..7 of each 128-bit half hold the mask, indexed by type >> 3,
+    // bitTable turns type & 7 into the bit to test within that byte
+    const __m256i maskTable = _mm256_set1_epi64x((i64)typeMask);
+    const __m256i bitTable = _mm256_set1_epi64x((i64)0x8040201008040201ull);
+    const __m256i seven = _mm256_set1_epi8(7);
+    for(; i + 32 <= count && n < max; i += 32) {
+        __m256i t = _mm256_loadu_si256((const __m256i*)(types + i));
+        __m256i byte = _mm256_shuffle_epi8(maskTable, _mm256_and_si256(_mm256_srli_epi16(t, 3), seven));
+        __m256i bit = _mm256_shuffle_epi8(bitTable, _mm256_and_si256(t, seven));
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_and_si256(byte, bit), bit);
+        u64 bits = (u32)_mm256_movemask_epi8(hit);
+        for(; bits && n < max; bits &= bits - 1)
+            indices[n++] = i + _zCountTrailingZeros64(bits);
+    }
+    return _zScanEventTypesScalar(types, i, count, typeMask, indices, n, max);
+}
+
+#endif // ZZZ_ARCH_X64
+
+// Collects the indices in [0, count) whose type is set in typeMask, with
+// AVX2 when _zCpuFeatures reports it, SSE2 on other x86-64 CPUs
+static u32 _zScanEventTypes(const u8* types, u64 count, u64 typeMask, u64* indices, u32 max)
+{
+#if ZZZ_ARCH_X64
+    if(_zCpuFeatures() & _ZCPU_AVX2)
+        return _zScanEventTypesAvx2(types, count, typeMask, indices, max);
+    return _zScanEventTypesSse2(types, count, typeMask, indices, max);
+#else
+    return _zScanEventTypesScalar(types, 0, count, typeMask, indices, 0, max);
+#endif
+}
+
+// Finds pending events whose type is in typeMask without consuming them,
+// in the order zNextEvent would return them. Writes pointers into the
+// lanes, valid until the next zConsumeEvents or zPollEvents, and returns
+// how many were found. Uses the dense type array when the queue was
+// created with eventTypeArray, otherwise reads the type of every event.
+u32 zFindEvents(ZZZ* app, u64 typeMask, const ZEvent** events, u32 max)
+{
+    if(!app || !events)
+        return 0;
+
+    ZEventQueue* eq = &app->eq;
+    _zBeginDrain(eq);
+    u32 found = 0;
+    for(u32 i = 0; i < ZEVENT_LANE_COUNT && found < max; ++i) {
+        ZEventLane* lane = eq->lanes + i;
+        u64 count = _zAcquireHead(lane) - lane->tail;
+        u64 first = lane->tail & lane->mask;
+        u64 firstCount = lane->capacity - first;
+        if(firstCount > count)
+            firstCount = count;
+
+        // The two contiguous spans of the ring
+        u64 spanStart[2] = { first, 0 };
+        u64 spanCount[2] = { firstCount, count - firstCount };
+        for(u32 s = 0; s < 2 && found < max; ++s) {
+            const ZEvent* span = lane->events + spanStart[s];
+            if(lane->types) {
+                u64 indices[64];
+                u64 done = 0;
+                while(done < spanCount[s] && found < max) {
+                    // Scan in blocks so the index buffer never overflows
+                    u64 block = spanCount[s] - done;
+                    if(block > 64)
+                        block = 64;
+                    u32 n = _zScanEventTypes(lane->types + spanStart[s] + done, block, typeMask, indices, max - found);
+                    for(u32 k = 0; k < n; ++k)
+                        events[found++] = span + done + indices[k];
+                    done += block;
+                }
+            } else {
+                for(u64 k = 0; k < spanCount[s] && found < max; ++k) {
+                    if((typeMask >> span[k].type) & 1)
+                        events[found++] = span + k;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+void zSetEventOverflowPolicy(ZZZ* app, i32 policy)
+{
+    if(!app)
+        return;
+    app->eq.overflow = policy;
+}
+
+// Only the types in mask are queued, the rest are discarded before they
+// claim a slot. Use ZEVENT_MASK() to build it, ZEVENT_MASK_ALL is the default.
+void zSetEventMask(ZZZ* app, u64 mask)
+{
+    if(!app)
+        return;
+    app->eq.eventMask = mask;
+}
+
+// Dispatches events of the given type straight to fn from the platform
+// layer instead of queueing them, on the thread that calls zPollEvents.
+// Passing a NULL fn goes back to queueing.
+void zSetEventCallback(ZZZ* app, i32 type, ZEventCallback fn, void* user)
+{
+    if(!app || type < 0 || type >= 64)
+        return;
+    app->eq.callbacks[type].fn = fn;
+    app->eq.callbacks[type].user = user;
+    if(fn)
+        app->eq.callbackMask |= ZEVENT_MASK(type);
+    else
+        app->eq.callbackMask &= ~ZEVENT_MASK(type);
+}
+
+void zSetEventCoalescing(ZZZ* app, i32 type, b32 enable)
+{
+    if(!app || type < 0 || type >= 64)
+        return;
+    if(enable)
+        app->eq.coalesceMask |= ZEVENT_MASK(type);
+    else
+        app->eq.coalesceMask &= ~ZEVENT_MASK(type);
+}
+
+// Posts a ZEVENT_USER..ZEVENT_USER_LAST event from any thread without
+// locking, it is queued in the window lane at the next zPollEvents. The
+// first post since the last drain also wakes a blocked zWaitEvents.
+// Returns FALSE if the type is out of range or ZZZ_POSTED_EVENT_CAPACITY
+// events are already waiting.
+b32 zPostEvent(ZZZ* app, const ZEvent* event)
+{
+    if(!app || !event || event->type < ZEVENT_USER || event->type > ZEVENT_USER_LAST)
+        return FALSE;
+
+    ZEventQueue* eq = &app->eq;
+    ZPostedEvent* cell;
+    u64 pos = _zAtomicLoad64(&eq->postHead);
+    for(;;) {
+        cell = eq->posted + (pos & (ZZZ_POSTED_EVENT_CAPACITY - 1));
+        i64 diff = (i64)_zAtomicLoad64(&cell->sequence) - (i64)pos;
+        if(diff == 0) {
+            if(_zAtomicCompareExchange64(&eq->postHead, pos, pos + 1))
+                break;
+        } else if(diff < 0) {
+            return FALSE;
+        }
+        pos = _zAtomicLoad64(&eq->postHead);
+    }
+
+    cell->event = *event;
+    cell->event.time = zGetTime();
+    _zAtomicStore64(&cell->sequence, pos + 1);
+    if(!_zAtomicExchange64(&eq->postWake, 1))
+        zPostEmptyEvent(app);
+    return TRUE;
+}
+
+// Copies the queue counters. With a threaded queue the producer and the
+// consumer counters are sampled without synchronization, so they may be a
+// few events apart.
+void zGetEventStats(ZZZ* app, ZEventStats* stats)
+{
+    if(!app || !stats)
+        return;
+    ZEventQueue* eq = &app->eq;
+    zMemCopy(stats->enqueued, eq->typeEnqueued, sizeof(stats->enqueued));
+    zMemCopy(stats->coalesced, eq->typeCoalesced, sizeof(stats->coalesced));
+    zMemCopy(stats->dropped, eq->typeDropped, sizeof(stats->dropped));
+    zMemCopy(stats->drained, eq->typeDrained, sizeof(stats->drained));
+    stats->highWaterMark = eq->highWaterMark;
+    stats->maxEventsPerPoll = eq->maxEventsPerPoll;
+}
+
+// Returns TRUE while the key is held down. With a threaded queue this is
+// the state as of the end of the last zPollEvents.
+b32 zGetKeyState(ZZZ* app, i32 key)
+{
+    if(!app || key < 0 || key >= _ZKEY_COUNT)
+        return FALSE;
+
+    ZEventQueue* eq = &app->eq;
+    const u32 word = (u32)key >> 6;
+    if(!eq->threaded)
+        return (eq->input.keysDown[word] >> (key & 63)) & 1;
+
+    u64 sequence, bits;
+    do {
+        while((sequence = _zAtomicLoad64(&eq->inputSequence)) & 1)
+            _zPlatformYield();
+        bits = eq->inputPublished.keysDown[word];
+        _zAtomicFence();
+    } while(_zAtomicLoad64(&eq->inputSequence) != sequence);
+    return (bits >> (key & 63)) & 1;
+}
+
+// Copies the whole keyboard and mouse state, see zGetKeyState
+void zGetInputSnapshot(ZZZ* app, ZInputState* state)
+{
+    if(!app || !state)
+        return;
+
+    ZEventQueue* eq = &app->eq;
+    if(!eq->threaded) {
+        zMemCopy(state, &eq->input, sizeof(ZInputState));
+        return;
+    }
+
+    // Taken before the copy so a press is never reported ahead of its key
+    // being down, one that lands in between shows up in the next snapshot
+    u64 keysPressed[8], keysReleased[8];
+    for(u32 i = 0; i < 8; ++i) {
+        keysPressed[i] = _zAtomicExchange64(&eq->keysPressedPending[i], 0);
+        keysReleased[i] = _zAtomicExchange64(&eq->keysReleasedPending[i], 0);
+    }
+    u64 buttons = _zAtomicExchange64(&eq->buttonsPending, 0);
+
+    u64 sequence;
+    do {
+        while((sequence = _zAtomicLoad64(&eq->inputSequence)) & 1)
+            _zPlatformYield();
+        zMemCopy(state, &eq->inputPublished, sizeof(ZInputState));
+        _zAtomicFence();
+    } while(_zAtomicLoad64(&eq->inputSequence) != sequence);
+
+    zMemCopy(state->keysPressed, keysPressed, sizeof(keysPressed));
+    zMemCopy(state->keysReleased, keysReleased, sizeof(keysReleased));
+    state->buttonsPressed = (u32)buttons;
+    state->buttonsReleased = (u32)(buttons >> 32);
+}
+
+// Returns the NUL terminated UTF-8 text of a ZEVENT_TEXT_INPUT event or
+// NULL for any other event. The text is valid until the next zPollEvents,
+// with a threaded queue until the consumer's next zNextEvent, zNextEvents,
+// zPeekEvents or zFindEvents.
+const char* zGetEventText(ZZZ* app, const ZEvent* event)
+{
+    if(!app || !event || event->type != ZEVENT_TEXT_INPUT)
+        return NULL;
+    if((u64)event->text.offset + event->text.length >= 2 * (u64)ZZZ_TRANSIENT_ARENA_SIZE)
+        return NULL;
+    return (const char*)app->eq.transient[0].base + event->text.offset;
+}
+
+// Converts an event or zGetTime timestamp to seconds since origin, pass
+// a zGetTime sample taken when the frame clock started to get event
+// times on that clock
+f64 zTimeToSeconds(u64 time, u64 origin)
+{
+    return (f64)(i64)(time - origin) / 1000000000.0;
+}
+
+/**
+ * Event log format, all values little endian as written by the recorder:
+ *
+ *   ZEventLogHeader
+ *   ZEvent[]  every event filled by the producer in order except user
+ *             events, a ZEVENT_UNKNOWN event stamped with the poll time
+ *             ends each zPollEvents. Its user.code counts the polls it
+ *             ends, a run of empty polls shares one marker. A ZEVENT_TEXT_INPUT is followed by its
+ *             NUL terminated text, zero padded to a multiple of
+ *             sizeof(ZEvent). A ZEVENT_FILE_DROPPED keeps file.count, its
+ *             paths pointer is replaced by text.length holding the size of
+ *             the NUL terminated paths that follow, padded the same way.
+ */
+#define _ZEVENT_LOG_MAGIC 0x525A5A5A // "ZZZR"
+#define _ZEVENT_LOG_VERSION 3
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 eventSize; // sizeof(ZEvent) of the recorder
+    u32 reserved;
+    u64 origin; // zGetTime when recording began
+    u64 reserved2;
+} ZEventLogHeader;
+
+static void _zEndRecording(ZEventQueue* eq)
+{
+    ZEventLog* log = &eq->log;
+    if(!log->file)
+        return;
+    if(eq->recordPending)
+        _zRecordEvent(eq);
+    // A failed write while recording it already ended the recording
+    if(!log->file)
+        return;
+    if(log->count)
+        _zPlatformWriteFile(log->file, log->buffer, log->count * sizeof(ZEvent));
+    _zPlatformCloseFile(log->file);
+    zMemRelease(log->buffer);
+    log->file = NULL;
+    log->buffer = NULL;
+    log->count = 0;
+    log->idleMarker = 0;
+    log->pollRecorded = FALSE;
+    eq->recordPending = NULL;
+}
+
+static void _zEndReplay(ZEventQueue* eq)
+{
+    ZEventLog* log = &eq->log;
+    if(!log->replay)
+        return;
+    _zPlatformUnmapFile(log->replayMapping, log->replaySize);
+    log->replay = NULL;
+    log->replayMapping = NULL;
+    log->replaySize = 0;
+    log->replayCount = 0;
+    log->replayCursor = 0;
+}
+
+// Index of the log entry after i, skipping the text or paths that follow
+// a ZEVENT_TEXT_INPUT or ZEVENT_FILE_DROPPED
+static u64 _zNextLogEntry(const ZEvent* entries, u64 i)
+{
+    u64 size = 0;
+    if(entries[i].type == ZEVENT_TEXT_INPUT)
+        size = (u64)entries[i].text.length + 1;
+    else if(entries[i].type == ZEVENT_FILE_DROPPED)
+        size = entries[i].text.length;
+    return i + 1 + (size + sizeof(ZEvent) - 1) / sizeof(ZEvent);
+}
+
+// Restores a text event from the recorded bytes. Merging only appends, so
+// when the pending text event is still open only the part of the recorded
+// text past it is added, just like _zInputCodepoint did.
+static void _zReplayText(ZEventQueue* eq, const ZEvent* recorded, const u8* text)
+{
+    if(!(eq->eventMask & ZEVENT_MASK(ZEVENT_TEXT_INPUT)))
+        return;
+
+    ZArena* arena = _zTransientArena(eq);
+    ZEvent* last = NULL;
+    if(!(eq->callbackMask & ZEVENT_MASK(ZEVENT_TEXT_INPUT))) {
+        last = _zLastEvent(eq, eq->lanes + ZEVENT_LANE_INPUT);
+        if(last && (last->type != ZEVENT_TEXT_INPUT ||
+                    eq->transient[0].base + last->text.offset + last->text.length + 1 != arena->base + arena->used ||
+                    last->text.length >= recorded->text.length))
+            last = NULL;
+    }
+
+    u32 have = last ? last->text.length : 0;
+    u64 used = arena->used;
+    if(last)
+        arena->used--;
+    u8* dst = _zArenaPush(arena, recorded->text.length - have + 1, 1);
+    if(!dst) {
+        arena->used = used;
+        _zCountDropped(eq, ZEVENT_TEXT_INPUT);
+        return;
+    }
+
+    ZEvent* ev = last;
+    if(ev) {
+        _zCountCoalesced(eq, ZEVENT_TEXT_INPUT);
+        _zRecordMerge(eq, ev);
+    } else {
+        ev = _zNewEvent(eq, ZEVENT_TEXT_INPUT);
+        if(!ev) {
+            arena->used = used;
+            return;
+        }
+        ev->text.offset = (u32)(dst - eq->transient[0].base);
+    }
+    zMemCopy(dst, text + have, recorded->text.length - have + 1);
+    ev->text.length = recorded->text.length;
+    ev->time = eq->time;
+}
+
+// Restores a file drop with its paths copied out of the log into the per
+// poll storage, the mapping goes away once the replay ends. Paths that do
+// not fit are cut short like a live drop.
+static void _zReplayFileDrop(ZEventQueue* eq, const ZEvent* recorded, const u8* bytes)
+{
+    ZEvent* ev = _zNewEvent(eq, ZEVENT_FILE_DROPPED);
+    if(!ev)
+        return;
+    ev->time = eq->time;
+
+    // Every path takes at least its NUL, which bounds a count from a log
+    // that is not trusted
+    u64 size = recorded->text.length;
+    u64 count = recorded->file.count > 0 ? (u64)recorded->file.count : 0;
+    if(count > size)
+        count = size;
+    ZArena* arena = _zTransientArena(eq);
+    u64 used = arena->used;
+    char** paths = _zArenaPush(arena, count * sizeof(char*), sizeof(char*));
+    char* copy = _zArenaPush(arena, size, 1);
+    if(!paths || !copy) {
+        arena->used = used;
+        return;
+    }
+    zMemCopy(copy, bytes, size);
+
+    i32 stored = 0;
+    u64 start = 0;
+    for(u64 at = 0; at < size && (u64)stored < count; ++at) {
+        if(copy[at])
+            continue;
+        paths[stored++] = copy + start;
+        start = at + 1;
+    }
+    ev->file.paths = paths;
+    ev->file.count = stored;
+}
+
+// Replayed events stand in for live input in the input state as well.
+// Returns FALSE for a release of something the state does not hold, which
+// is dropped like a live one would be.
+static b32 _zTrackReplayedEvent(ZInputState* state, const ZEvent* ev)
+{
+    switch(ev->type) {
+        case ZEVENT_KEY_PRESSED:
+        case ZEVENT_KEY_RELEASED:
+            {
+                return _zTrackKey(state, ev->keyboard.key, ev->type, ev->keyboard.mods) != ZEVENT_UNKNOWN;
+            } break;
+        case ZEVENT_BUTTON_PRESSED:
+        case ZEVENT_BUTTON_RELEASED:
+            {
+                return _zTrackMouseButton(state, ev->mouse.button, ev->type, ev->mouse.mods);
+            } break;
+        case ZEVENT_CURSOR_MOVED:
+            {
+                state->cursorX = ev->cursor.x;
+                state->cursorY = ev->cursor.y;
+            } break;
+        default:
+            break;
+    }
+    return TRUE;
+}
+
+// Feeds a recorded event through the same path the backend used, so it
+// merges into the pending one again when it was coalesced
+static void _zReplayEvent(ZEventQueue* eq, const ZEvent* recorded)
+{
+    ZEventLog* log = &eq->log;
+    eq->time = recorded->time - log->replayOrigin + log->replayStart;
+    // Whatever posted a user event posts it again. The recorder leaves
+    // them out, a log from elsewhere could carry another process' pointers.
+    if(recorded->type >= ZEVENT_USER)
+        return;
+    if(!_zTrackReplayedEvent(&eq->input, recorded))
+        return;
+    if(recorded->type == ZEVENT_TEXT_INPUT) {
+        _zReplayText(eq, recorded, (const u8*)(recorded + 1));
+        return;
+    }
+    if(recorded->type == ZEVENT_FILE_DROPPED) {
+        _zReplayFileDrop(eq, recorded, (const u8*)(recorded + 1));
+        return;
+    }
+    ZEvent* ev = _zCoalesceEvent(eq, recorded->type);
+    if(!ev)
+        ev = _zNewEvent(eq, recorded->type);
+    if(!ev)
+        return;
+    *ev = *recorded;
+    ev->time = eq->time;
+}
+
+// Called by the backend at the end of zPollEvents, injects the replayed
+// events that are due and ends the recorded poll
+void _zPumpEventLog(ZEventQueue* eq)
+{
+    if(!eq)
+        return;
+
+    ZEventLog* log = &eq->log;
+    if(log->replay && log->replayIdle) {
+        log->replayIdle--;
+    } else if(log->replay) {
+        u64 elapsed = zGetTime() - log->replayStart;
+        log->replayPumping = TRUE;
+        while(log->replayCursor < log->replayCount) {
+            u64 end = log->replayCursor;
+            while(end < log->replayCount && log->replay[end].type != ZEVENT_UNKNOWN)
+                end = _zNextLogEntry(log->replay, end);
+            // A log cut short in the middle of a text is replayed up to it
+            if(end > log->replayCount)
+                end = log->replayCount;
+            if(log->replayMode == ZEVENT_REPLAY_REALTIME && end < log->replayCount &&
+                    log->replay[end].time - log->replayOrigin > elapsed)
+                break;
+            for(u64 i = log->replayCursor; i < end; i = _zNextLogEntry(log->replay, i)) {
+                if(_zNextLogEntry(log->replay, i) > log->replayCount)
+                    break;
+                _zReplayEvent(eq, log->replay + i);
+            }
+            log->replayCursor = end + 1;
+            if(log->replayMode == ZEVENT_REPLAY_FAST) {
+                if(end < log->replayCount && log->replay[end].user.code > 1)
+                    log->replayIdle = (u64)log->replay[end].user.code - 1;
+                break;
+            }
+        }
+        log->replayPumping = FALSE;
+    }
+    if(log->replay && !log->replayIdle && log->replayCursor >= log->replayCount)
+        _zEndReplay(eq);
+
+    // The file is only written once the buffer fills up or the recording
+    // ends, an idle app adds to one marker instead of a new entry per poll
+    if(log->file) {
+        if(eq->recordPending)
+            _zRecordEvent(eq);
+        if(!log->pollRecorded && log->idleMarker) {
+            ZEvent* marker = log->buffer + log->idleMarker - 1;
+            marker->time = zGetTime();
+            marker->user.code++;
+            return;
+        }
+        b32 empty = !log->pollRecorded;
+        ZEvent* marker = _zRecordSlot(eq);
+        if(marker) {
+            zMemZero(marker, sizeof(ZEvent));
+            marker->type = ZEVENT_UNKNOWN;
+            marker->time = zGetTime();
+            marker->user.code = 1;
+            log->idleMarker = empty ? log->count : 0;
+            log->pollRecorded = FALSE;
+        }
+    }
+}
+
+// Starts appending every event to a new log file at path, replacing an
+// ongoing recording. Call it from the thread that calls zPollEvents.
+ZErr zRecordBegin(ZZZ* app, const char* path)
+{
+    if(!app || !path)
+        return ZERR_INVALID_ARGUMENTS;
+
+    ZEventQueue* eq = &app->eq;
+    _zEndRecording(eq);
+    ZEventLog* log = &eq->log;
+    log->buffer = zMemReserve(ZZZ_EVENT_LOG_BUFFER_CAPACITY * sizeof(ZEvent));
+    if(!log->buffer)
+        return ZERR_FAILED_TO_RESERVE_MEMORY;
+    void* file = _zPlatformCreateFile(path);
+    if(!file) {
+        zMemRelease(log->buffer);
+        log->buffer = NULL;
+        return ZERR_FAILED_TO_OPEN_FILE;
     }
-    return ev->type != ZEVENT_UNKNOWN;
+
+    ZEventLogHeader header;
+    zMemZero(&header, sizeof(header));
+    header.magic = _ZEVENT_LOG_MAGIC;
+    header.version = _ZEVENT_LOG_VERSION;
+    header.eventSize = sizeof(ZEvent);
+    header.origin = zGetTime();
+    if(!_zPlatformWriteFile(file, &header, sizeof(header))) {
+        _zPlatformCloseFile(file);
+        zMemRelease(log->buffer);
+        log->buffer = NULL;
+        return ZERR_FAILED_TO_WRITE_FILE;
+    }
+    log->file = file;
+    log->count = 0;
+    log->idleMarker = 0;
+    log->pollRecorded = FALSE;
+    return ZERR_NONE;
+}
+
+void zRecordEnd(ZZZ* app)
+{
+    if(!app)
+        return;
+    _zEndRecording(&app->eq);
+}
+
+// Maps a log written by zRecordBegin and replays it from the next
+// zPollEvents on, ZEVENT_REPLAY_* picks the pace. Live input is dropped
+// until the log runs out or zReplayEnd, posted events and window closes
+// still arrive. Call it from the thread that
+// calls zPollEvents.
+ZErr zReplayBegin(ZZZ* app, const char* path, i32 mode)
+{
+    if(!app || !path)
+        return ZERR_INVALID_ARGUMENTS;
+
+    ZEventQueue* eq = &app->eq;
+    _zEndReplay(eq);
+    u64 size;
+    const void* mapping = _zPlatformMapFile(path, &size);
+    if(!mapping)
+        return ZERR_FAILED_TO_OPEN_FILE;
+
+    const ZEventLogHeader* header = mapping;
+    if(size < sizeof(ZEventLogHeader) ||
+            header->magic != _ZEVENT_LOG_MAGIC ||
+            header->version != _ZEVENT_LOG_VERSION ||
+            header->eventSize != sizeof(ZEvent)) {
+        _zPlatformUnmapFile(mapping, size);
+        return ZERR_INVALID_EVENT_LOG;
+    }
+
+    // Types index masks and per type tables, a log from elsewhere is not
+    // trusted to keep them in range
+    const ZEvent* entries = (const ZEvent*)(header + 1);
+    u64 count = (size - sizeof(ZEventLogHeader)) / sizeof(ZEvent);
+    for(u64 i = 0; i < count; i = _zNextLogEntry(entries, i)) {
+        if(entries[i].type < 0 || entries[i].type >= 64) {
+            _zPlatformUnmapFile(mapping, size);
+            return ZERR_INVALID_EVENT_LOG;
+        }
+    }
+
+    ZEventLog* log = &eq->log;
+    log->replayMapping = mapping;
+    log->replaySize = size;
+    log->replay = entries;
+    log->replayCount = count;
+    log->replayCursor = 0;
+    log->replayOrigin = header->origin;
+    log->replayStart = zGetTime();
+    log->replayMode = mode;
+    log->replayIdle = 0;
+    return ZERR_NONE;
+}
+
+void zReplayEnd(ZZZ* app)
+{
+    if(!app)
+        return;
+    _zEndReplay(&app->eq);
+}
+
+b32 zIsReplaying(ZZZ* app)
+{
+    return app && app->eq.log.replay;
 }
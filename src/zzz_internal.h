@@ -3,7 +3,139 @@
 
 #include "zzz.h"
 
+#if ZZZ_CC_MSVC
+    #include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define ZZZ_ARCH_X64 1
+    #include <immintrin.h>
+    // AVX2 code is compiled per function and only called after
+    // _zCpuFeatures reported it, the rest of the build stays baseline x86-64
+    #if ZZZ_CC_MSVC
+        #define ZZZ_TARGET_AVX2
+    #else
+        #define ZZZ_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define ZZZ_ARCH_X64 0
+#endif
+
+// Acquire load and release store, used where the event queue is shared
+// between a producer and a consumer thread
+static inline u64 _zAtomicLoad64(const volatile u64* ptr)
+{
+#if ZZZ_CC_MSVC
+    // x64 loads already have acquire semantics, only keep the compiler in check
+    u64 value = *ptr;
+    _ReadWriteBarrier();
+    return value;
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void _zAtomicStore64(volatile u64* ptr, u64 value)
+{
+#if ZZZ_CC_MSVC
+    _ReadWriteBarrier();
+    *ptr = value;
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Returns TRUE and stores desired if *ptr still holds expected
+static inline b32 _zAtomicCompareExchange64(volatile u64* ptr, u64 expected, u64 desired)
+{
+#if ZZZ_CC_MSVC
+    return (u64)_InterlockedCompareExchange64((volatile __int64*)ptr, (__int64)desired, (__int64)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(ptr, &expected, desired, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
+}
+
+// Stores value and returns the previous one, full barrier
+static inline u64 _zAtomicExchange64(volatile u64* ptr, u64 value)
+{
+#if ZZZ_CC_MSVC
+    return (u64)_InterlockedExchange64((volatile __int64*)ptr, (__int64)value);
+#else
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// ORs value into *ptr and returns the previous value, full barrier
+static inline u64 _zAtomicOr64(volatile u64* ptr, u64 value)
+{
+#if ZZZ_CC_MSVC
+    return (u64)_InterlockedOr64((volatile __int64*)ptr, (__int64)value);
+#else
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Orders the plain accesses before it against the ones after it
+static inline void _zAtomicFence(void)
+{
+#if ZZZ_CC_MSVC
+    // x64 only reorders a store with a later load, which no caller relies on
+    _ReadWriteBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+// Index of the lowest set bit, value must not be 0
+static inline u32 _zCountTrailingZeros64(u64 value)
+{
+#if ZZZ_CC_MSVC
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll(value);
+#endif
+}
+
+void _zPlatformYield(void);
+
+#define _ZCPU_AVX2 0x1
+#define _ZCPU_ERMS 0x2
+
+// _ZCPU_* flags of the running CPU, always 0 outside x86-64. Defined in
+// zzz_memory.c, which picks its copy routines by them too.
+u32 _zCpuFeatures(void);
+
+// File services for the event log, the handle is opaque to the core
+void* _zPlatformCreateFile(const char* path);
+b32 _zPlatformWriteFile(void* file, const void* data, u64 nbytes);
+void _zPlatformCloseFile(void* file);
+const void* _zPlatformMapFile(const char* path, u64* size);
+void _zPlatformUnmapFile(const void* data, u64 size);
+
+// Arena the producer allocates event payloads from
+static inline ZArena* _zTransientArena(ZEventQueue* eq)
+{
+    return eq->transient + eq->transientIndex;
+}
+
+ZErr _zInitEventQueue(ZEventQueue* eq, const ZZZInitInfo* info);
+void _zTerminateEventQueue(ZEventQueue* eq);
 ZEvent* _zNewEvent(ZEventQueue* eq, int type);
+void _zFlushEvents(ZEventQueue* eq);
+void _zDispatchEventCallback(ZEventQueue* eq);
+void _zPumpPostedEvents(ZEventQueue* eq);
+void _zPumpEventLog(ZEventQueue* eq);
+void _zBeginPollEvents(ZEventQueue* eq);
+void* _zArenaPush(ZArena* arena, u64 size, u64 align);
 void _zInputKey(ZEventQueue* eq, i32 key, i32 scancode, i32 action, i32 mods);
+void _zInputCodepoint(ZEventQueue* eq, u32 codepoint);
+void _zInputMouseButton(ZEventQueue* eq, i32 button, i32 action, i32 mods);
+void _zInputReleaseAll(ZEventQueue* eq);
+void _zInputCursorPos(ZEventQueue* eq, f32 x, f32 y);
+void _zInputScroll(ZEventQueue* eq, f32 dx, f32 dy);
+void _zInputWindowSize(ZEventQueue* eq, i32 width, i32 height);
+void _zInputFramebufferSize(ZEventQueue* eq, i32 width, i32 height);
 
 #endif // ZZZ_INTERNAL_H
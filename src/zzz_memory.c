@@ -0,0 +1,347 @@
+#include "zzz.h"
+#include "zzz_internal.h"
+
+#include <stdint.h> // uintptr_t, freestanding
+
+// zMemSet, zMemZero and zMemCopy for every platform. On x86-64 the SSE2 or
+// AVX2 variant is picked through CPUID on first use, elsewhere the word
+// sized loops are used. Regions passed to zMemCopy must not overlap.
+
+#if ZZZ_ARCH_X64 && !ZZZ_CC_MSVC
+    #include <cpuid.h>
+#endif
+
+typedef void (*_ZMemSetProc)(u8* dst, u8 value, u64 nbytes);
+typedef void (*_ZMemCopyProc)(u8* dst, const u8* src, u64 nbytes);
+
+// Fewer than 8 bytes without a loop, compilers like to turn byte loops
+// into calls to the libc functions these replace
+static void _zMemSetTiny(u8* dst, u8 value, u64 nbytes)
+{
+    if(nbytes >= 4) {
+        dst[0] = value;
+        dst[1] = value;
+        dst[2] = value;
+        dst[3] = value;
+        dst[nbytes - 4] = value;
+        dst[nbytes - 3] = value;
+        dst[nbytes - 2] = value;
+        dst[nbytes - 1] = value;
+    } else if(nbytes) {
+        dst[0] = value;
+        dst[nbytes >> 1] = value;
+        dst[nbytes - 1] = value;
+    }
+}
+
+static void _zMemCopyTiny(u8* dst, const u8* src, u64 nbytes)
+{
+    if(nbytes >= 4) {
+        u8 a0 = src[0], a1 = src[1], a2 = src[2], a3 = src[3];
+        u8 b0 = src[nbytes - 4], b1 = src[nbytes - 3], b2 = src[nbytes - 2], b3 = src[nbytes - 1];
+        dst[0] = a0;
+        dst[1] = a1;
+        dst[2] = a2;
+        dst[3] = a3;
+        dst[nbytes - 4] = b0;
+        dst[nbytes - 3] = b1;
+        dst[nbytes - 2] = b2;
+        dst[nbytes - 1] = b3;
+    } else if(nbytes) {
+        u8 a = src[0], b = src[nbytes >> 1], c = src[nbytes - 1];
+        dst[0] = a;
+        dst[nbytes >> 1] = b;
+        dst[nbytes - 1] = c;
+    }
+}
+
+#if !ZZZ_ARCH_X64
+
+static void _zMemSetWord(u8* dst, u8 value, u64 nbytes)
+{
+    u64 head = (0 - (uintptr_t)dst) & 7;
+    if(head > nbytes)
+        head = nbytes;
+    _zMemSetTiny(dst, value, head);
+    dst += head;
+    nbytes -= head;
+    u64 pattern = value * 0x0101010101010101ull;
+    for(; nbytes >= 8; nbytes -= 8, dst += 8)
+        *(u64*)dst = pattern;
+    _zMemSetTiny(dst, value, nbytes);
+}
+
+static void _zMemCopyWord(u8* dst, const u8* src, u64 nbytes)
+{
+    // Words only line up when both pointers share the same misalignment,
+    // otherwise go through a word at a time in bytes
+    if((((uintptr_t)dst ^ (uintptr_t)src) & 7) == 0) {
+        u64 head = (0 - (uintptr_t)dst) & 7;
+        if(head > nbytes)
+            head = nbytes;
+        _zMemCopyTiny(dst, src, head);
+        dst += head;
+        src += head;
+        nbytes -= head;
+        for(; nbytes >= 8; nbytes -= 8, dst += 8, src += 8)
+            *(u64*)dst = *(const u64*)src;
+    } else {
+        for(; nbytes >= 8; nbytes -= 8, dst += 8, src += 8)
+            _zMemCopyTiny(dst, src, 8);
+    }
+    _zMemCopyTiny(dst, src, nbytes);
+}
+
+#else
+
+// Sizes below one vector are covered with two overlapping stores of the
+// next smaller width, so a 32 byte ZEvent takes two instructions.
+static void _zMemSetSmall(u8* dst, u8 value, u64 nbytes)
+{
+    if(nbytes >= 8) {
+        __m128i v = _mm_set1_epi8((char)value);
+        _mm_storel_epi64((__m128i*)dst, v);
+        _mm_storel_epi64((__m128i*)(dst + nbytes - 8), v);
+    } else {
+        _zMemSetTiny(dst, value, nbytes);
+    }
+}
+
+static void _zMemCopySmall(u8* dst, const u8* src, u64 nbytes)
+{
+    if(nbytes >= 8) {
+        __m128i a = _mm_loadl_epi64((const __m128i*)src);
+        __m128i b = _mm_loadl_epi64((const __m128i*)(src + nbytes - 8));
+        _mm_storel_epi64((__m128i*)dst, a);
+        _mm_storel_epi64((__m128i*)(dst + nbytes - 8), b);
+    } else {
+        _zMemCopyTiny(dst, src, nbytes);
+    }
+}
+
+// Copies of at least this many bytes use rep movsb, set when the CPU reports
+// ERMS. Past a few KiB its microcode beats the vector loops, which also
+// stall on 4 KiB aliasing when src and dst share a page offset.
+static u64 _zMemRepThreshold = ~0ull;
+
+static void _zMemCopyRep(u8* dst, const u8* src, u64 nbytes)
+{
+#if ZZZ_CC_MSVC
+    __movsb(dst, src, nbytes);
+#else
+    __asm__ volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(nbytes) : : "memory");
+#endif
+}
+
+static void _zMemSetSse2(u8* dst, u8 value, u64 nbytes)
+{
+    if(nbytes < 16) {
+        _zMemSetSmall(dst, value, nbytes);
+        return;
+    }
+    __m128i v = _mm_set1_epi8((char)value);
+    u8* end = dst + nbytes;
+    _mm_storeu_si128((__m128i*)dst, v);
+    _mm_storeu_si128((__m128i*)(end - 16), v);
+    // Aligned stores for everything in between the two unaligned ends
+    u8* p = (u8*)(((uintptr_t)dst + 16) & ~(uintptr_t)15);
+    for(; p + 64 <= end; p += 64) {
+        _mm_store_si128((__m128i*)p, v);
+        _mm_store_si128((__m128i*)(p + 16), v);
+        _mm_store_si128((__m128i*)(p + 32), v);
+        _mm_store_si128((__m128i*)(p + 48), v);
+    }
+    for(; p + 16 <= end; p += 16)
+        _mm_store_si128((__m128i*)p, v);
+}
+
+static void _zMemCopySse2(u8* dst, const u8* src, u64 nbytes)
+{
+    if(nbytes < 16) {
+        _zMemCopySmall(dst, src, nbytes);
+        return;
+    }
+    if(nbytes >= _zMemRepThreshold) {
+        _zMemCopyRep(dst, src, nbytes);
+        return;
+    }
+    __m128i head = _mm_loadu_si128((const __m128i*)src);
+    __m128i tail = _mm_loadu_si128((const __m128i*)(src + nbytes - 16));
+    u8* end = dst + nbytes;
+    u8* p = (u8*)(((uintptr_t)dst + 16) & ~(uintptr_t)15);
+    const u8* s = src + (p - dst);
+    for(; p + 64 <= end; p += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)s);
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_store_si128((__m128i*)p, a);
+        _mm_store_si128((__m128i*)(p + 16), b);
+        _mm_store_si128((__m128i*)(p + 32), c);
+        _mm_store_si128((__m128i*)(p + 48), d);
+    }
+    for(; p + 16 <= end; p += 16, s += 16)
+        _mm_store_si128((__m128i*)p, _mm_loadu_si128((const __m128i*)s));
+    _mm_storeu_si128((__m128i*)dst, head);
+    _mm_storeu_si128((__m128i*)(end - 16), tail);
+}
+
+ZZZ_TARGET_AVX2 static void _zMemSetAvx2(u8* dst, u8 value, u64 nbytes)
+{
+    if(nbytes < 32) {
+        _zMemSetSse2(dst, value, nbytes);
+        return;
+    }
+    __m256i v = _mm256_set1_epi8((char)value);
+    u8* end = dst + nbytes;
+    _mm256_storeu_si256((__m256i*)dst, v);
+    _mm256_storeu_si256((__m256i*)(end - 32), v);
+    u8* p = (u8*)(((uintptr_t)dst + 32) & ~(uintptr_t)31);
+    for(; p + 128 <= end; p += 128) {
+        _mm256_store_si256((__m256i*)p, v);
+        _mm256_store_si256((__m256i*)(p + 32), v);
+        _mm256_store_si256((__m256i*)(p + 64), v);
+        _mm256_store_si256((__m256i*)(p + 96), v);
+    }
+    for(; p + 32 <= end; p += 32)
+        _mm256_store_si256((__m256i*)p, v);
+}
+
+ZZZ_TARGET_AVX2 static void _zMemCopyAvx2(u8* dst, const u8* src, u64 nbytes)
+{
+    if(nbytes < 32) {
+        _zMemCopySse2(dst, src, nbytes);
+        return;
+    }
+    if(nbytes >= _zMemRepThreshold) {
+        _zMemCopyRep(dst, src, nbytes);
+        return;
+    }
+    __m256i head = _mm256_loadu_si256((const __m256i*)src);
+    __m256i tail = _mm256_loadu_si256((const __m256i*)(src + nbytes - 32));
+    u8* end = dst + nbytes;
+    u8* p = (u8*)(((uintptr_t)dst + 32) & ~(uintptr_t)31);
+    const u8* s = src + (p - dst);
+    for(; p + 128 <= end; p += 128, s += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)s);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(s + 96));
+        _mm256_store_si256((__m256i*)p, a);
+        _mm256_store_si256((__m256i*)(p + 32), b);
+        _mm256_store_si256((__m256i*)(p + 64), c);
+        _mm256_store_si256((__m256i*)(p + 96), d);
+    }
+    for(; p + 32 <= end; p += 32, s += 32)
+        _mm256_store_si256((__m256i*)p, _mm256_loadu_si256((const __m256i*)s));
+    _mm256_storeu_si256((__m256i*)dst, head);
+    _mm256_storeu_si256((__m256i*)(end - 32), tail);
+}
+
+static u32 _zDetectCpuFeatures(void)
+{
+    u32 ecx1, ebx7, res = 0;
+#if ZZZ_CC_MSVC
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return 0;
+    __cpuid(info, 1);
+    ecx1 = (u32)info[2];
+    __cpuidex(info, 7, 0);
+    ebx7 = (u32)info[1];
+#else
+    u32 eax, ebx, ecx, edx;
+    if(__get_cpuid_max(0, NULL) < 7)
+        return 0;
+    __cpuid(1, eax, ebx, ecx, edx);
+    ecx1 = ecx;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    ebx7 = ebx;
+#endif
+    if(ebx7 & (1u << 9))
+        res |= _ZCPU_ERMS;
+    // AVX2 also needs AVX and the OS saving the YMM registers (OSXSAVE, XCR0)
+    if(!(ebx7 & (1u << 5)) || !(ecx1 & (1u << 27)) || !(ecx1 & (1u << 28)))
+        return res;
+#if ZZZ_CC_MSVC
+    u64 xcr0 = _xgetbv(0);
+#else
+    u32 lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    u64 xcr0 = ((u64)hi << 32) | lo;
+#endif
+    if((xcr0 & 6) == 6)
+        res |= _ZCPU_AVX2;
+    return res;
+}
+
+#endif // ZZZ_ARCH_X64
+
+// Detected once, threads racing through the first call store the same value
+u32 _zCpuFeatures(void)
+{
+    static b32 detected = FALSE;
+    static u32 features = 0;
+    if(!detected) {
+#if ZZZ_ARCH_X64
+        features = _zDetectCpuFeatures();
+#endif
+        detected = TRUE;
+    }
+    return features;
+}
+
+static void _zMemSetResolve(u8* dst, u8 value, u64 nbytes);
+static void _zMemCopyResolve(u8* dst, const u8* src, u64 nbytes);
+
+// Start out pointing at the resolvers. Threads racing through the first call
+// all store the same pointers.
+static _ZMemSetProc _zMemSetImpl = _zMemSetResolve;
+static _ZMemCopyProc _zMemCopyImpl = _zMemCopyResolve;
+
+static void _zMemSelect(void)
+{
+#if ZZZ_ARCH_X64
+    u32 features = _zCpuFeatures();
+    if(features & _ZCPU_ERMS)
+        _zMemRepThreshold = 2048;
+    if(features & _ZCPU_AVX2) {
+        _zMemSetImpl = _zMemSetAvx2;
+        _zMemCopyImpl = _zMemCopyAvx2;
+    } else {
+        _zMemSetImpl = _zMemSetSse2;
+        _zMemCopyImpl = _zMemCopySse2;
+    }
+#else
+    _zMemSetImpl = _zMemSetWord;
+    _zMemCopyImpl = _zMemCopyWord;
+#endif
+}
+
+static void _zMemSetResolve(u8* dst, u8 value, u64 nbytes)
+{
+    _zMemSelect();
+    _zMemSetImpl(dst, value, nbytes);
+}
+
+static void _zMemCopyResolve(u8* dst, const u8* src, u64 nbytes)
+{
+    _zMemSelect();
+    _zMemCopyImpl(dst, src, nbytes);
+}
+
+void zMemSet(void* dst, i32 value, u64 nbytes)
+{
+    _zMemSetImpl((u8*)dst, (u8)value, nbytes);
+}
+
+void zMemZero(void* dst, u64 nbytes)
+{
+    _zMemSetImpl((u8*)dst, 0, nbytes);
+}
+
+void zMemCopy(void* dst, const void* src, u64 nbytes)
+{
+    _zMemCopyImpl((u8*)dst, (const u8*)src, nbytes);
+}
@@ -0,0 +1,283 @@
+#include "zzz.h"
+#include "zzz_internal.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Headless backend, there is no display connection so zPollEvents only
+// delivers posted and replayed events. It carries the OS services the
+// core needs to run on a Linux box without a display, such as CI.
+
+ZErr zInit(ZZZ* app, const ZZZInitInfo* info)
+{
+    if(!app || !info) {
+        return ZERR_INVALID_ARGUMENTS;
+    }
+    zMemZero(app, sizeof(ZZZ));
+
+    app->surface.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(app->surface.wakeFd < 0) {
+        return ZERR_FAILED_TO_OPEN_FILE;
+    }
+
+    ZErr err = _zInitEventQueue(&app->eq, info);
+    if(err != ZERR_NONE) {
+        close(app->surface.wakeFd);
+        return err;
+    }
+
+    return ZERR_NONE;
+}
+
+void zTerminate(ZZZ* app)
+{
+    if(!app)
+        return;
+    close(app->surface.wakeFd);
+    _zTerminateEventQueue(&app->eq);
+    zMemZero(app, sizeof(ZZZ));
+}
+
+void zSetWindowVisibility(ZZZ* app, b32 should_visible)
+{
+    (void)app;
+    (void)should_visible;
+}
+
+void zPollEvents(ZZZ* app)
+{
+    // Reset the wakeup counter, the posted events are drained below anyway
+    u64 count;
+    _zBeginPollEvents(&app->eq);
+    while(read(app->surface.wakeFd, &count, sizeof(count)) > 0)
+        ;
+    _zPumpPostedEvents(&app->eq);
+    _zPumpEventLog(&app->eq);
+    _zFlushEvents(&app->eq);
+}
+
+// Sleeps until zPostEmptyEvent, then polls. A replay keeps the loop
+// running since there is nothing else to wake it.
+void zWaitEvents(ZZZ* app)
+{
+    struct pollfd pfd = { app->surface.wakeFd, POLLIN, 0 };
+    if(!zIsReplaying(app))
+        poll(&pfd, 1, -1);
+    zPollEvents(app);
+}
+
+// Same as zWaitEvents but gives up after timeout nanoseconds
+void zWaitEventsTimeout(ZZZ* app, u64 timeout)
+{
+    struct pollfd pfd = { app->surface.wakeFd, POLLIN, 0 };
+    // Round up so a sub-millisecond timeout still sleeps instead of spinning
+    u64 ms = (timeout + 999999) / 1000000;
+    if(ms > 0x7fffffff)
+        ms = 0x7fffffff;
+    if(!zIsReplaying(app))
+        poll(&pfd, 1, (int)ms);
+    zPollEvents(app);
+}
+
+void zPostEmptyEvent(ZZZ* app)
+{
+    if(!app)
+        return;
+    u64 one = 1;
+    ssize_t res = write(app->surface.wakeFd, &one, sizeof(one));
+    (void)res;
+}
+
+void _zPlatformYield(void)
+{
+    sched_yield();
+}
+
+// Every mapping keeps its size and the offset of the returned pointer in
+// the 64 bytes in front of that pointer, so zMemRelease can hand the whole
+// mapping back to munmap. The header gets a page of its own, the returned
+// pointer is page aligned and zMemDecommit or zMemProtect never reach it.
+#define _ZMEM_HEADER_SIZE 64
+
+// From linux/mempolicy.h, allocate on the node of the CPU that faults
+#define _ZMPOL_LOCAL 4
+
+static void* _zMemMap(u64 total, int prot, int flags)
+{
+    void* res = mmap(NULL, total, prot, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if(res == MAP_FAILED)
+        return NULL;
+    // Fails without NUMA support, which leaves the default first touch
+    syscall(SYS_mbind, res, total, _ZMPOL_LOCAL, NULL, 0, 0);
+    return res;
+}
+
+static void* _zMemSetHeader(u8* base, u64 total, u64 offset)
+{
+    u64* header = (u64*)(base + offset - _ZMEM_HEADER_SIZE);
+    header[0] = total;
+    header[1] = offset;
+    return base + offset;
+}
+
+// Pages are only backed when first written, so large reservations skip the
+// swap accounting with MAP_NORESERVE and can span gigabytes of address
+// space. The local policy makes every page land on the NUMA node of the
+// thread that first touches it, even when the process runs under an
+// interleave policy, so a buffer should be filled by the thread using it.
+void* zMemReserve(u64 nbytes)
+{
+    u64 page = zMemGetPageSize();
+    u64 total = ((nbytes + page - 1) & ~(page - 1)) + page;
+    u8* base = _zMemMap(total, PROT_READ | PROT_WRITE, nbytes >= ZZZ_MEM_NORESERVE_SIZE ? MAP_NORESERVE : 0);
+    if(!base)
+        return NULL;
+    return _zMemSetHeader(base, total, page);
+}
+
+void zMemRelease(void* ptr)
+{
+    if(!ptr)
+        return;
+    u64* header = (u64*)((u8*)ptr - _ZMEM_HEADER_SIZE);
+    munmap((u8*)ptr - header[1], header[0]);
+}
+
+u64 zMemGetPageSize(void)
+{
+    static u64 pageSize = 0;
+    if(!pageSize)
+        pageSize = (u64)sysconf(_SC_PAGESIZE);
+    return pageSize;
+}
+
+// Address space only, pages are inaccessible and not charged against the
+// commit limit until zMemCommit. Released with zMemRelease.
+void* zMemReserveRange(u64 nbytes)
+{
+    u64 page = zMemGetPageSize();
+    u64 total = ((nbytes + page - 1) & ~(page - 1)) + page;
+    u8* base = _zMemMap(total, PROT_NONE, 0);
+    if(!base)
+        return NULL;
+    if(mprotect(base, page, PROT_READ | PROT_WRITE) != 0) {
+        munmap(base, total);
+        return NULL;
+    }
+    return _zMemSetHeader(base, total, page);
+}
+
+// Widens [ptr, ptr + nbytes) to whole pages like VirtualAlloc does
+static u8* _zMemPageRange(void* ptr, u64 nbytes, u64* length)
+{
+    u64 page = zMemGetPageSize();
+    uintptr_t first = (uintptr_t)ptr & ~(uintptr_t)(page - 1);
+    uintptr_t last = ((uintptr_t)ptr + nbytes + page - 1) & ~(uintptr_t)(page - 1);
+    *length = last - first;
+    return (u8*)first;
+}
+
+b32 zMemCommit(void* ptr, u64 nbytes)
+{
+    if(!nbytes)
+        return TRUE;
+    if(!ptr)
+        return FALSE;
+    u64 length;
+    u8* first = _zMemPageRange(ptr, nbytes, &length);
+    return mprotect(first, length, PROT_READ | PROT_WRITE) == 0;
+}
+
+// Drops the pages, they read back as zero once committed again
+void zMemDecommit(void* ptr, u64 nbytes)
+{
+    if(!ptr || !nbytes)
+        return;
+    u64 length;
+    u8* first = _zMemPageRange(ptr, nbytes, &length);
+    madvise(first, length, MADV_DONTNEED);
+    mprotect(first, length, PROT_NONE);
+}
+
+b32 zMemProtect(void* ptr, u64 nbytes, u32 protect)
+{
+    if(!nbytes)
+        return TRUE;
+    if(!ptr)
+        return FALSE;
+    int prot = PROT_NONE;
+    if(protect & ZMEM_PROTECT_WRITE)
+        prot = PROT_READ | PROT_WRITE;
+    else if(protect & ZMEM_PROTECT_READ)
+        prot = PROT_READ;
+    u64 length;
+    u8* first = _zMemPageRange(ptr, nbytes, &length);
+    return mprotect(first, length, prot) == 0;
+}
+
+u64 zGetTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+void* _zPlatformCreateFile(const char* path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+        return NULL;
+    // Store fd + 1 so descriptor 0 is not mistaken for a failure
+    return (void*)(intptr_t)(fd + 1);
+}
+
+b32 _zPlatformWriteFile(void* file, const void* data, u64 nbytes)
+{
+    int fd = (int)(intptr_t)file - 1;
+    while(nbytes) {
+        ssize_t written = write(fd, data, nbytes);
+        if(written <= 0)
+            return FALSE;
+        data = (const u8*)data + written;
+        nbytes -= (u64)written;
+    }
+    return TRUE;
+}
+
+void _zPlatformCloseFile(void* file)
+{
+    close((int)(intptr_t)file - 1);
+}
+
+const void* _zPlatformMapFile(const char* path, u64* size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return NULL;
+    *size = (u64)st.st_size;
+    return data;
+}
+
+void _zPlatformUnmapFile(const void* data, u64 size)
+{
+    munmap((void*)data, size);
+}
@@ -10,9 +10,10 @@ ZErr zInit(ZZZ* app, const ZZZInitInfo* info)
     }
     zMemZero(app, sizeof(ZZZ));
 
-    WNDCLASSA wc;
-    u64 wndclass_size = sizeof(WNDCLASSA);
-    const char* wndclass_name = "FluxWindowClass1";
+    // A Unicode window class so WM_CHAR carries UTF-16 instead of the ANSI code page
+    WNDCLASSW wc;
+    u64 wndclass_size = sizeof(WNDCLASSW);
+    LPCWSTR wndclass_name = L"FluxWindowClass1";
     RECT wr;
 
     app->surface.hInstance = (HINSTANCE)GetModuleHandleA(NULL);
@@ -28,7 +29,7 @@ ZErr zInit(ZZZ* app, const ZZZInitInfo* info)
     wc.hbrBackground = (HBRUSH)COLOR_WINDOW;
     wc.lpszClassName = wndclass_name;
 
-    app->surface.mainWindowClass = RegisterClassA(&wc);
+    app->surface.mainWindowClass = RegisterClassW(&wc);
     if(!app->surface.mainWindowClass) {
         return ZERR_FAILED_TO_REGISTER_WIN32_WINDOW_CLASS;
     }
@@ -54,14 +55,36 @@ ZErr zInit(ZZZ* app, const ZZZInitInfo* info)
 
     if(!handle) {
         return ZERR_FAILED_TO_CREATE_WIN32_WINDOW;
-    } else {
-        SetPropA(handle, "ZZZ", &app->eq);
-        app->surface.hWnd = handle;
     }
 
+    ZErr err = _zInitEventQueue(&app->eq, info);
+    if(err != ZERR_NONE) {
+        DestroyWindow(handle);
+        return err;
+    }
+    SetPropA(handle, "ZZZ", &app->eq);
+    DragAcceptFiles(handle, TRUE);
+    app->surface.hWnd = handle;
+
     return ZERR_NONE;
 }
 
+void zTerminate(ZZZ* app)
+{
+    if(!app)
+        return;
+
+    if(app->surface.hWnd) {
+        RemovePropA(app->surface.hWnd, "ZZZ");
+        DestroyWindow(app->surface.hWnd);
+    }
+    if(app->surface.mainWindowClass) {
+        UnregisterClassA(MAKEINTATOM(app->surface.mainWindowClass), app->surface.hInstance);
+    }
+    _zTerminateEventQueue(&app->eq);
+    zMemZero(app, sizeof(ZZZ));
+}
+
 void zSetWindowVisibility(ZZZ* app, b32 should_visible)
 {
     i32 show_window_command_flag = should_visible ? SW_SHOWNA : SW_HIDE;
@@ -73,24 +96,88 @@ void zPollEvents(ZZZ* app)
     (void)app;
     MSG msg;
 
-    if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+    _zBeginPollEvents(&app->eq);
+    while(PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
         if(msg.message == WM_QUIT) {
+            app->eq.time = zGetTime();
             _zNewEvent(&app->eq, ZEVENT_WINDOW_CLOSED);
         } else {
             TranslateMessage(&msg);
-            DispatchMessage(&msg);
+            DispatchMessageW(&msg);
         }
     }
+    _zPumpPostedEvents(&app->eq);
+    _zPumpEventLog(&app->eq);
+    _zFlushEvents(&app->eq);
+}
+
+// Sleeps in the OS until the thread has input, then polls. A replay keeps
+// the loop running since live input is masked out and would not wake it.
+void zWaitEvents(ZZZ* app)
+{
+    if(!zIsReplaying(app))
+        MsgWaitForMultipleObjectsEx(0, NULL, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    zPollEvents(app);
+}
+
+// Same as zWaitEvents but gives up after timeout nanoseconds
+void zWaitEventsTimeout(ZZZ* app, u64 timeout)
+{
+    // Round up so a sub-millisecond timeout still sleeps instead of spinning
+    u64 ms = (timeout + 999999) / 1000000;
+    if(ms >= INFINITE)
+        ms = INFINITE - 1;
+    if(!zIsReplaying(app))
+        MsgWaitForMultipleObjectsEx(0, NULL, (DWORD)ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    zPollEvents(app);
+}
+
+// Wakes zWaitEvents from any thread, WM_NULL goes through the window's
+// message queue which is exactly what the wait is blocked on
+void zPostEmptyEvent(ZZZ* app)
+{
+    if(!app || !app->surface.hWnd)
+        return;
+    PostMessageA(app->surface.hWnd, WM_NULL, 0, 0);
+}
+
+void _zPlatformYield(void)
+{
+    SwitchToThread();
 }
 
 static int _zWin32GetKeyMods(void);
 static i32 _zWin32Scancode2Keycode(i32 scancode);
+static u64 _zWin32GetMessageTime(void);
 
 LRESULT CALLBACK _zWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     ZEventQueue* eq = (ZEventQueue*)GetPropA(hWnd, "ZZZ");
     if(!eq) {
-        return DefWindowProc(hWnd, uMsg, wParam, lParam);
+        return DefWindowProcW(hWnd, uMsg, wParam, lParam);
+    }
+
+    switch(uMsg) {
+        case WM_KEYDOWN:
+        case WM_SYSKEYDOWN:
+        case WM_KEYUP:
+        case WM_SYSKEYUP:
+        case WM_MOUSEMOVE:
+        case WM_MOUSEWHEEL:
+        case WM_MOUSEHWHEEL:
+        case WM_LBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+        case WM_MBUTTONDOWN:
+        case WM_XBUTTONDOWN:
+        case WM_LBUTTONUP:
+        case WM_RBUTTONUP:
+        case WM_MBUTTONUP:
+        case WM_XBUTTONUP:
+            eq->time = _zWin32GetMessageTime();
+            break;
+        default:
+            eq->time = zGetTime();
+            break;
     }
 
     switch(uMsg) {
@@ -103,12 +190,131 @@ LRESULT CALLBACK _zWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
             {
                 RECT r;
                 GetClientRect(hWnd, &r);
-                ZEvent* ev = _zNewEvent(eq, ZEVENT_WINDOW_RESIZED);
-                if(!ev) {
-                    return DefWindowProc(hWnd, uMsg, wParam, lParam);
+                _zInputWindowSize(eq, r.right - r.left, r.bottom - r.top);
+            } break;
+        case WM_KILLFOCUS:
+            {
+                // The releases of anything held now go to the focused window
+                _zInputReleaseAll(eq);
+            } break;
+        case WM_MOUSEMOVE:
+            {
+                _zInputCursorPos(eq, (f32)GET_X_LPARAM(lParam), (f32)GET_Y_LPARAM(lParam));
+            } break;
+        case WM_MOUSEWHEEL:
+            {
+                _zInputScroll(eq, 0.0f, (f32)GET_WHEEL_DELTA_WPARAM(wParam) / (f32)WHEEL_DELTA);
+            } break;
+        case WM_MOUSEHWHEEL:
+            {
+                // NOTE: The X-axis is inverted for consistency with the other platforms
+                _zInputScroll(eq, -((f32)GET_WHEEL_DELTA_WPARAM(wParam) / (f32)WHEEL_DELTA), 0.0f);
+            } break;
+        case WM_LBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+        case WM_MBUTTONDOWN:
+        case WM_XBUTTONDOWN:
+        case WM_LBUTTONUP:
+        case WM_RBUTTONUP:
+        case WM_MBUTTONUP:
+        case WM_XBUTTONUP:
+            {
+                i32 button, action;
+
+                if (uMsg == WM_LBUTTONDOWN || uMsg == WM_LBUTTONUP)
+                    button = ZMOUSE_BUTTON_LEFT;
+                else if (uMsg == WM_RBUTTONDOWN || uMsg == WM_RBUTTONUP)
+                    button = ZMOUSE_BUTTON_RIGHT;
+                else if (uMsg == WM_MBUTTONDOWN || uMsg == WM_MBUTTONUP)
+                    button = ZMOUSE_BUTTON_MIDDLE;
+                else if (GET_XBUTTON_WPARAM(wParam) == XBUTTON1)
+                    button = ZMOUSE_BUTTON_4;
+                else
+                    button = ZMOUSE_BUTTON_5;
+
+                if (uMsg == WM_LBUTTONDOWN || uMsg == WM_RBUTTONDOWN ||
+                        uMsg == WM_MBUTTONDOWN || uMsg == WM_XBUTTONDOWN)
+                    action = ZEVENT_BUTTON_PRESSED;
+                else
+                    action = ZEVENT_BUTTON_RELEASED;
+
+                // Keep receiving the buttons while one is held outside the window
+                if (action == ZEVENT_BUTTON_PRESSED && !eq->input.buttonsDown)
+                    SetCapture(hWnd);
+                _zInputMouseButton(eq, button, action, _zWin32GetKeyMods());
+                if (action == ZEVENT_BUTTON_RELEASED && !eq->input.buttonsDown)
+                    ReleaseCapture();
+
+                if (uMsg == WM_XBUTTONDOWN || uMsg == WM_XBUTTONUP) {
+                    _zDispatchEventCallback(eq);
+                    return TRUE;
+                }
+            } break;
+        case WM_CHAR:
+            {
+                // Characters outside the BMP arrive as two messages, one
+                // per UTF-16 surrogate
+                static WCHAR highSurrogate = 0;
+                const WCHAR unit = (WCHAR)wParam;
+                if(unit >= 0xd800 && unit <= 0xdbff) {
+                    highSurrogate = unit;
+                    break;
                 }
-                ev->window.width = r.right - r.left;
-                ev->window.height = r.bottom - r.top;
+                u32 codepoint = unit;
+                if(unit >= 0xdc00 && unit <= 0xdfff) {
+                    codepoint = highSurrogate ? 0x10000 + ((u32)(highSurrogate - 0xd800) << 10) + (unit - 0xdc00) : 0;
+                }
+                highSurrogate = 0;
+                // Control characters are reported as keys only
+                if(codepoint >= 32 && (codepoint < 127 || codepoint >= 160))
+                    _zInputCodepoint(eq, codepoint);
+            } break;
+        case WM_UNICHAR:
+            {
+                // Answering TRUE to UNICODE_NOCHAR asks for WM_UNICHAR over WM_CHAR
+                if(wParam == UNICODE_NOCHAR)
+                    return TRUE;
+                if(wParam >= 32 && (wParam < 127 || wParam >= 160))
+                    _zInputCodepoint(eq, (u32)wParam);
+                _zDispatchEventCallback(eq);
+                return 0;
+            } break;
+        case WM_DROPFILES:
+            {
+                HDROP drop = (HDROP)wParam;
+                ZEvent* ev = _zNewEvent(eq, ZEVENT_FILE_DROPPED);
+                if(ev) {
+                    // The path list and the strings all go to the per poll
+                    // arena, a drop that does not fit is cut short
+                    ZArena* arena = _zTransientArena(eq);
+                    const UINT count = DragQueryFileW(drop, 0xffffffff, NULL, 0);
+                    char** paths = _zArenaPush(arena, count * sizeof(char*), sizeof(char*));
+                    i32 stored = 0;
+                    for(UINT i = 0; paths && i < count; ++i) {
+                        // Room for the worst case of 3 UTF-8 bytes per UTF-16
+                        // unit, the UTF-16 path goes right after and both
+                        // are trimmed to the converted length
+                        const UINT length = DragQueryFileW(drop, i, NULL, 0);
+                        char* path = _zArenaPush(arena, 3 * (u64)length + 1, 1);
+                        WCHAR* wide = _zArenaPush(arena, ((u64)length + 1) * sizeof(WCHAR), sizeof(WCHAR));
+                        if(!path || !wide) {
+                            if(path)
+                                arena->used = (u64)((u8*)path - arena->base);
+                            break;
+                        }
+                        DragQueryFileW(drop, i, wide, length + 1);
+                        int bytes = WideCharToMultiByte(CP_UTF8, 0, wide, -1, path, 3 * length + 1, NULL, NULL);
+                        if(bytes <= 0) {
+                            arena->used = (u64)((u8*)path - arena->base);
+                            continue;
+                        }
+                        arena->used = (u64)((u8*)path - arena->base) + (u64)bytes;
+                        paths[stored++] = path;
+                    }
+                    ev->file.paths = paths;
+                    ev->file.count = stored;
+                }
+                DragFinish(drop);
             } break;
         case WM_KEYDOWN:
         case WM_SYSKEYDOWN:
@@ -206,7 +412,8 @@ LRESULT CALLBACK _zWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
             break;
     }
 
-    return DefWindowProc(hWnd, uMsg, wParam, lParam);
+    _zDispatchEventCallback(eq);
+    return DefWindowProcW(hWnd, uMsg, wParam, lParam);
 }
 
 void* zMemReserve(u64 nbytes)
@@ -231,21 +438,150 @@ void zMemRelease(void* ptr)
         MEM_RELEASE);
 }
 
-void zMemSet(void* dst, i32 value, u64 nbytes)
+u64 zMemGetPageSize(void)
+{
+    static u64 pageSize = 0;
+    if(!pageSize) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        pageSize = info.dwPageSize;
+    }
+    return pageSize;
+}
+
+// Address space only, nothing is charged against the commit limit until
+// zMemCommit. Released with zMemRelease.
+void* zMemReserveRange(u64 nbytes)
+{
+    return VirtualAllocEx(
+        GetCurrentProcess(),
+        NULL,
+        nbytes,
+        MEM_RESERVE,
+        PAGE_NOACCESS);
+}
+
+b32 zMemCommit(void* ptr, u64 nbytes)
+{
+    if(!nbytes)
+        return TRUE;
+    if(!ptr)
+        return FALSE;
+    return VirtualAllocEx(
+        GetCurrentProcess(),
+        (LPVOID)ptr,
+        nbytes,
+        MEM_COMMIT,
+        PAGE_READWRITE) != NULL;
+}
+
+// Drops the pages, they read back as zero once committed again
+void zMemDecommit(void* ptr, u64 nbytes)
+{
+    if(!ptr || !nbytes)
+        return;
+    VirtualFreeEx(
+        GetCurrentProcess(),
+        (LPVOID)ptr,
+        nbytes,
+        MEM_DECOMMIT);
+}
+
+b32 zMemProtect(void* ptr, u64 nbytes, u32 protect)
 {
-    for(u64 i = 0; i < nbytes; ++i)
-        ((i8*)dst)[i] = (i8)value;
+    if(!nbytes)
+        return TRUE;
+    if(!ptr)
+        return FALSE;
+    DWORD prot = PAGE_NOACCESS;
+    if(protect & ZMEM_PROTECT_WRITE)
+        prot = PAGE_READWRITE;
+    else if(protect & ZMEM_PROTECT_READ)
+        prot = PAGE_READONLY;
+    DWORD old;
+    return VirtualProtectEx(GetCurrentProcess(), (LPVOID)ptr, nbytes, prot, &old) != 0;
+}
+
+u64 zGetTime(void)
+{
+    static u64 frequency = 0;
+    LARGE_INTEGER counter;
+    if(!frequency) {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        frequency = (u64)f.QuadPart;
+    }
+    QueryPerformanceCounter(&counter);
+    u64 ticks = (u64)counter.QuadPart;
+    return (ticks / frequency) * 1000000000ull + (ticks % frequency) * 1000000000ull / frequency;
+}
+
+void* _zPlatformCreateFile(const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return NULL;
+    return file;
+}
+
+b32 _zPlatformWriteFile(void* file, const void* data, u64 nbytes)
+{
+    // WriteFile takes a DWORD size, larger writes go in chunks
+    while(nbytes) {
+        DWORD chunk = nbytes > 0x40000000 ? 0x40000000 : (DWORD)nbytes;
+        DWORD written;
+        if(!WriteFile((HANDLE)file, data, chunk, &written, NULL) || written == 0)
+            return FALSE;
+        data = (const u8*)data + written;
+        nbytes -= written;
+    }
+    return TRUE;
+}
+
+void _zPlatformCloseFile(void* file)
+{
+    CloseHandle((HANDLE)file);
+}
+
+const void* _zPlatformMapFile(const char* path, u64* size)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!mapping)
+        return NULL;
+    // The view keeps the mapping alive after its handle is closed
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if(!data)
+        return NULL;
+    *size = (u64)fileSize.QuadPart;
+    return data;
 }
 
-void zMemZero(void* dst, u64 nbytes)
+void _zPlatformUnmapFile(const void* data, u64 size)
 {
-    return zMemSet(dst, 0, nbytes);
+    (void)size;
+    UnmapViewOfFile(data);
 }
 
-void zMemCopy(void* dst, const void* src, u64 nbytes)
+// Maps GetMessageTime, milliseconds on the GetTickCount clock, to the
+// zGetTime clock by subtracting the message's age from the current time
+u64 _zWin32GetMessageTime(void)
 {
-    for(u64 i = 0; i < nbytes; ++i)
-        ((i8*)dst)[i] = ((i8*)src)[i];
+    u64 now = zGetTime();
+    u64 age = (u64)(DWORD)(GetTickCount() - (DWORD)GetMessageTime()) * 1000000ull;
+    return age < now ? now - age : now;
 }
 
 int _zWin32GetKeyMods(void)